@@ -3,7 +3,10 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
 
 /* A block device. */
 struct block
@@ -17,8 +20,8 @@ struct block
     const struct block_operations *ops;  /* Driver operations. */
     void *aux;                          /* Extra data owned by driver. */
 
-    unsigned long long read_cnt;        /* Number of sectors read. */
-    unsigned long long write_cnt;       /* Number of sectors written. */
+    struct blockstat stats;             /* I/O statistics. */
+    block_sector_t next_sector;         /* Sector after the last one used. */
   };
 
 /* List of all block devices. */
@@ -28,6 +31,7 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void account_io (struct block *, block_sector_t, int64_t start);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -120,9 +124,16 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
+  int64_t start;
+
   check_sector (block, sector);
+  if (block == block_by_role[BLOCK_FILESYS])
+    trace (TRACE_BLOCK, TRACE_BLOCK_READ, sector, thread_current ()->io_inode);
+  start = timer_ns ();
   block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  account_io (block, sector, start);
+  block->stats.read_cnt++;
+  block->stats.read_bytes += BLOCK_SECTOR_SIZE;
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +144,76 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
+  int64_t start;
+
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  if (block == block_by_role[BLOCK_FILESYS])
+    trace (TRACE_BLOCK, TRACE_BLOCK_WRITE, sector, thread_current ()->io_inode);
+  start = timer_ns ();
   block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  account_io (block, sector, start);
+  block->stats.write_cnt++;
+  block->stats.write_bytes += BLOCK_SECTOR_SIZE;
+}
+
+/* Returns the histogram bucket for VALUE.  See
+   BLOCKSTAT_BUCKETS. */
+static int
+histogram_bucket (uint64_t value)
+{
+  int bucket = 0;
+
+  while (value != 0 && bucket < BLOCKSTAT_BUCKETS - 1)
+    {
+      value >>= 1;
+      bucket++;
+    }
+  return bucket;
+}
+
+/* User programs tell disks from partitions by comparing struct
+   blockstat's type with BLOCKSTAT_DISK.  Fails to compile, with
+   a negative array size, if that does not match BLOCK_RAW. */
+typedef char blockstat_disk_is_block_raw[BLOCK_RAW == BLOCKSTAT_DISK
+                                         ? 1 : -1];
+
+/* Returns true if BLOCK is a partition.  Disks are registered as
+   BLOCK_RAW and partitions with any other type (see
+   partition.c).  A partition passes each request on to the disk
+   that contains it. */
+static bool
+is_partition (const struct block *block)
+{
+  return block->type != BLOCK_RAW;
+}
+
+/* Records in BLOCK's statistics a request for SECTOR that began
+   at time START, as returned by timer_ns().  Like the sector
+   counts, the statistics are not locked, so concurrent requests
+   may occasionally be miscounted.
+
+   Service times and seek distances are only recorded for disks.
+   A partition's request is timed when its disk carries it out, so
+   timing it at the partition as well would count it twice, with
+   seek distances relative to the partition's start. */
+static void
+account_io (struct block *block, block_sector_t sector, int64_t start)
+{
+  int64_t ns;
+  block_sector_t distance;
+
+  if (is_partition (block))
+    return;
+
+  ns = timer_ns () - start;
+  distance = (sector >= block->next_sector
+              ? sector - block->next_sector
+              : block->next_sector - sector);
+  block->stats.service_ns += ns;
+  block->stats.service[histogram_bucket (ns / 1000)]++;
+  block->stats.seek[histogram_bucket (distance)]++;
+  block->next_sector = sector + 1;
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,10 +237,35 @@ block_type (struct block *block)
   return block->type;
 }
 
-/* Prints statistics for each block device used for a Pintos role. */
+/* Prints histogram HIST of BLOCK's statistics, labeled LABEL,
+   with each bucket's upper bound followed by UNIT.  Omits empty
+   buckets. */
+static void
+print_histogram (const struct block *block, const char *label,
+                 const uint32_t hist[BLOCKSTAT_BUCKETS], const char *unit)
+{
+  int i;
+
+  printf ("%s: %s:", block->name, label);
+  for (i = 0; i < BLOCKSTAT_BUCKETS; i++)
+    if (hist[i] != 0)
+      {
+        if (i == BLOCKSTAT_BUCKETS - 1)
+          printf (" %"PRIu32" >=%d%s", hist[i], 1 << (i - 1), unit);
+        else
+          printf (" %"PRIu32" <%d%s", hist[i], 1 << i, unit);
+      }
+  printf ("\n");
+}
+
+/* Prints statistics for each block device used for a Pintos
+   role, followed by details for every block device that has
+   done any I/O.  A partition's requests are also included in
+   its disk's totals, and only the disk has timing details. */
 void
 block_print_stats (void)
 {
+  struct list_elem *e;
   int i;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
@@ -173,11 +275,77 @@ block_print_stats (void)
         {
           printf ("%s (%s): %llu reads, %llu writes\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  block->stats.read_cnt, block->stats.write_cnt);
+        }
+    }
+
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e))
+    {
+      struct block *block = list_entry (e, struct block, list_elem);
+      const struct blockstat *st = &block->stats;
+      uint64_t requests = st->read_cnt + st->write_cnt;
+
+      if (requests == 0)
+        continue;
+      if (is_partition (block))
+        {
+          printf ("%s: %"PRIu64" bytes read, %"PRIu64" bytes written "
+                  "(included in its disk's totals)\n",
+                  block->name, st->read_bytes, st->write_bytes);
+          continue;
         }
+      printf ("%s: %"PRIu64" bytes read, %"PRIu64" bytes written, "
+              "%"PRIu64" us average service time\n",
+              block->name, st->read_bytes, st->write_bytes,
+              st->service_ns / requests / 1000);
+      print_histogram (block, "service time", st->service, "us");
+      print_histogram (block, "seek distance", st->seek, " sectors");
+      if (st->interrupts != 0)
+        printf ("%s: %"PRIu32" interrupts, channel lock wait "
+                "%"PRIu64" us total, %"PRIu64" us max\n",
+                block->name, st->interrupts,
+                st->lock_wait_ns / 1000, st->max_lock_wait_ns / 1000);
     }
 }
 
+/* Copies the statistics for the IDX'th block device, in kernel
+   probe order, into ST.  Returns false if there is no such
+   device. */
+bool
+block_get_stats (size_t idx, struct blockstat *st)
+{
+  struct block *block;
+
+  for (block = block_first (); block != NULL; block = block_next (block))
+    if (idx-- == 0)
+      {
+        *st = block->stats;
+        strlcpy (st->name, block->name, sizeof st->name);
+        st->type = block->type;
+        return true;
+      }
+  return false;
+}
+
+/* Records that a request to BLOCK waited NS nanoseconds for the
+   driver's lock on its channel. */
+void
+block_note_lock_wait (struct block *block, int64_t ns)
+{
+  block->stats.lock_wait_ns += ns;
+  if ((uint64_t) ns > block->stats.max_lock_wait_ns)
+    block->stats.max_lock_wait_ns = ns;
+}
+
+/* Records a completion interrupt for BLOCK.  May be called from
+   an interrupt handler. */
+void
+block_note_interrupt (struct block *block)
+{
+  block->stats.interrupts++;
+}
+
 /* Registers a new block device with the given NAME.  If
    EXTRA_INFO is non-null, it is printed as part of a user
    message.  The block device's SIZE in sectors and its TYPE must
@@ -198,8 +366,8 @@ block_register (const char *name, enum block_type type,
   block->size = size;
   block->ops = ops;
   block->aux = aux;
-  block->read_cnt = 0;
-  block->write_cnt = 0;
+  memset (&block->stats, 0, sizeof block->stats);
+  block->next_sector = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -224,11 +392,11 @@ list_elem_to_block (struct list_elem *list_elem)
 unsigned long long
 block_get_read_cnt (struct block *block)
 {
-  return block->read_cnt;
+  return block->stats.read_cnt;
 }
 
 unsigned long long
 block_get_write_cnt (struct block *block)
 {
-  return block->write_cnt;
+  return block->stats.write_cnt;
 }
@@ -1,8 +1,10 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <inttypes.h>
+#include <blockstat.h>
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -58,6 +60,7 @@ enum block_type block_type (struct block *);
 
 /* Statistics. */
 void block_print_stats (void);
+bool block_get_stats (size_t idx, struct blockstat *);
 
 /* Lower-level interface to block device drivers. */
 
@@ -74,4 +77,8 @@ struct block *block_register (const char *name, enum block_type,
 unsigned long long block_get_read_cnt (struct block *block);
 unsigned long long block_get_write_cnt (struct block *block);
 
+/* Statistics reported by drivers. */
+void block_note_lock_wait (struct block *, int64_t ns);
+void block_note_interrupt (struct block *);
+
 #endif /* devices/block.h */
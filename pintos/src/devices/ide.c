@@ -9,6 +9,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -57,6 +58,7 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    struct block *block;        /* Block device, once registered. */
   };
 
 /* An ATA channel (aka controller).
@@ -71,6 +73,7 @@ struct channel
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    struct ata_disk *active;    /* Disk with a request in progress. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -85,7 +88,10 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
+static void acquire_channel (struct ata_disk *);
+static void release_channel (struct ata_disk *);
 static void select_sector (struct ata_disk *, block_sector_t);
+static unsigned disk_no (const struct ata_disk *);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -124,7 +130,9 @@ ide_init (void)
           NOT_REACHED ();
         }
       lock_init (&c->lock);
+      lock_set_name (&c->lock, c->name);
       c->expecting_interrupt = false;
+      c->active = NULL;
       sema_init (&c->completion_wait, 0);
  
       /* Initialize devices. */
@@ -136,6 +144,7 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->block = NULL;
         }
 
       /* Register interrupt handler. */
@@ -306,6 +315,7 @@ identify_ata_device (struct ata_disk *d)
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
+  d->block = block;
   partition_scan (block);
 }
 
@@ -346,14 +356,16 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
-  lock_acquire (&c->lock);
+  acquire_channel (d);
+  trace (TRACE_IDE, TRACE_IDE_READ, sec_no, disk_no (d));
   select_sector (d, sec_no);
   issue_pio_command (c, CMD_READ_SECTOR_RETRY);
   sema_down (&c->completion_wait);
   if (!wait_while_busy (d))
     PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
   input_sector (c, buffer);
-  lock_release (&c->lock);
+  trace (TRACE_IDE, TRACE_IDE_DONE, sec_no, disk_no (d));
+  release_channel (d);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -366,14 +378,16 @@ ide_write (void *d_, block_sector_t sec_no, const void *buffer)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
-  lock_acquire (&c->lock);
+  acquire_channel (d);
+  trace (TRACE_IDE, TRACE_IDE_WRITE, sec_no, disk_no (d));
   select_sector (d, sec_no);
   issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy (d))
     PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
   output_sector (c, buffer);
   sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+  trace (TRACE_IDE, TRACE_IDE_DONE, sec_no, disk_no (d));
+  release_channel (d);
 }
 
 static struct block_operations ide_operations =
@@ -382,6 +396,37 @@ static struct block_operations ide_operations =
     ide_write
   };
 
+/* Acquires the lock on disk D's channel and makes D its active
+   disk, recording how long the lock took to get. */
+static void
+acquire_channel (struct ata_disk *d)
+{
+  struct channel *c = d->channel;
+  int64_t start = timer_ns ();
+
+  lock_acquire (&c->lock);
+  block_note_lock_wait (d->block, timer_ns () - start);
+  c->active = d;
+}
+
+/* Releases the lock on disk D's channel. */
+static void
+release_channel (struct ata_disk *d)
+{
+  struct channel *c = d->channel;
+
+  c->active = NULL;
+  lock_release (&c->lock);
+}
+
+/* Returns a number identifying disk D in traces: 0 for hda, 1
+   for hdb, and so on. */
+static unsigned
+disk_no (const struct ata_disk *d)
+{
+  return (d->channel - channels) * 2 + d->dev_no;
+}
+
 /* Selects device D, waiting for it to become ready, and then
    writes SEC_NO to the disk's sector selection registers.  (We
    use LBA mode.) */
@@ -514,6 +559,8 @@ interrupt_handler (struct intr_frame *f)
         if (c->expecting_interrupt) 
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
+            if (c->active != NULL)
+              block_note_interrupt (c->active->block);
             sema_up (&c->completion_wait);      /* Wake up waiter. */
           }
         else
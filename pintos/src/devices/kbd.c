@@ -7,6 +7,7 @@
 #include "devices/shutdown.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/workqueue.h"
 
 /* Keyboard data register port. */
 #define DATA_REG 0x60
@@ -24,12 +25,28 @@ static bool caps_lock;
 /* Number of keys pressed. */
 static int64_t key_cnt;
 
+/* Scancodes read by the interrupt handler but not yet
+   interpreted, as a circular buffer.  Accessed only with
+   interrupts off. */
+#define SCANCODE_CNT 64
+static unsigned scancodes[SCANCODE_CNT];
+static unsigned scancode_head;          /* Next scancode written here. */
+static unsigned scancode_tail;          /* Next scancode read here. */
+
+/* Interprets the buffered scancodes.  Runs on the "events"
+   workqueue, which has a single worker, so the shift key state
+   is never updated concurrently. */
+static struct work interpret_work;
+
 static intr_handler_func keyboard_interrupt;
+static void interpret_scancodes (void *aux);
+static void interpret_scancode (unsigned code);
 
 /* Initializes the keyboard. */
 void
 kbd_init (void) 
 {
+  work_init (&interpret_work, interpret_scancodes, NULL);
   intr_register_ext (0x21, keyboard_interrupt, "8042 Keyboard");
 }
 
@@ -92,27 +109,65 @@ static const struct keymap shifted_keymap[] =
 
 static bool map_key (const struct keymap[], unsigned scancode, uint8_t *);
 
+/* Keyboard interrupt handler.  Only reads the scancode; the
+   work of interpreting it is deferred to interpret_scancodes(),
+   to keep the time spent with interrupts off short. */
 static void
 keyboard_interrupt (struct intr_frame *args UNUSED) 
+{
+  /* Keyboard scancode. */
+  unsigned code;
+
+  /* Read scancode, including second byte if prefix code. */
+  code = inb (DATA_REG);
+  if (code == 0xe0)
+    code = (code << 8) | inb (DATA_REG);
+
+  /* Buffer it, dropping it if the buffer is full. */
+  if (scancode_head - scancode_tail < SCANCODE_CNT)
+    scancodes[scancode_head++ % SCANCODE_CNT] = code;
+  work_schedule (&interpret_work);
+}
+
+/* Interprets each scancode buffered by the interrupt handler. */
+static void
+interpret_scancodes (void *aux UNUSED) 
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+      bool have_code;
+      unsigned code = 0;
+
+      old_level = intr_disable ();
+      have_code = scancode_tail != scancode_head;
+      if (have_code)
+        code = scancodes[scancode_tail++ % SCANCODE_CNT];
+      intr_set_level (old_level);
+
+      if (!have_code)
+        break;
+      interpret_scancode (code);
+    }
+}
+
+/* Interprets scancode CODE, updating the shift key state or
+   appending a character to the input buffer. */
+static void
+interpret_scancode (unsigned code) 
 {
   /* Status of shift keys. */
   bool shift = left_shift || right_shift;
   bool alt = left_alt || right_alt;
   bool ctrl = left_ctrl || right_ctrl;
 
-  /* Keyboard scancode. */
-  unsigned code;
-
   /* False if key pressed, true if key released. */
   bool release;
 
   /* Character that corresponds to `code'. */
   uint8_t c;
 
-  /* Read scancode, including second byte if prefix code. */
-  code = inb (DATA_REG);
-  if (code == 0xe0)
-    code = (code << 8) | inb (DATA_REG);
+  enum intr_level old_level;
 
   /* Bit 0x80 distinguishes key press from key release
      (even if there's a prefix). */
@@ -154,11 +209,13 @@ keyboard_interrupt (struct intr_frame *args UNUSED)
             c += 0x80;
 
           /* Append to keyboard buffer. */
+          old_level = intr_disable ();
           if (!input_full ())
             {
               key_cnt++;
               input_putc (c);
             }
+          intr_set_level (old_level);
         }
     }
   else
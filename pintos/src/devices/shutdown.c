@@ -4,8 +4,15 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
@@ -13,6 +20,12 @@
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "vm/zram.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -94,6 +107,8 @@ shutdown_power_off (void)
   filesys_done ();
 #endif
 
+  profile_stop ();
+  trace_dump (NULL);
   print_stats ();
 
   printf ("Powering off...\n");
@@ -123,12 +138,24 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  intr_print_stats ();
+  workqueue_print_stats ();
+  palloc_print_stats ();
+  kmem_print_stats ();
+  synch_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
+  lock_print_stats ();
   console_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+#ifdef VM
+  frame_print_stats ();
+  share_print_stats ();
+  swap_print_stats ();
+  zram_print_stats ();
+#endif
 }
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
   
@@ -24,8 +25,16 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Time stamp counter increments per second.
+   Initialized by timer_calibrate(). */
+static uint64_t cycles_per_sec;
+
+/* Timer ticks over which the time stamp counter is calibrated. */
+#define CALIBRATE_TICKS 4
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
+static void calibrate_cycles (void);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
@@ -39,7 +48,8 @@ timer_init (void)
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and the rate of the time stamp counter, used by timer_ns(). */
 void
 timer_calibrate (void) 
 {
@@ -64,6 +74,27 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  calibrate_cycles ();
+}
+
+/* Measures the rate of the time stamp counter against the
+   timer, over CALIBRATE_TICKS timer ticks starting at a tick
+   boundary. */
+static void
+calibrate_cycles (void)
+{
+  int64_t start = ticks;
+  uint64_t start_cycles;
+
+  while (ticks == start)
+    barrier ();
+  start = ticks;
+  start_cycles = timer_cycles ();
+  while (ticks < start + CALIBRATE_TICKS)
+    barrier ();
+  cycles_per_sec = ((timer_cycles () - start_cycles)
+                    * TIMER_FREQ / CALIBRATE_TICKS);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -84,6 +115,55 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the value of the CPU's time stamp counter, which
+   increments at a constant rate of timer_cycles_per_sec() per
+   second.  See [IA32-v2b] "RDTSC". */
+uint64_t
+timer_cycles (void)
+{
+  uint64_t cycles;
+  asm volatile ("rdtsc" : "=A" (cycles));
+  return cycles;
+}
+
+/* Returns the number of time stamp counter increments per
+   second, or 0 if timer_calibrate() has not yet run. */
+uint64_t
+timer_cycles_per_sec (void)
+{
+  return cycles_per_sec;
+}
+
+/* Converts CYCLES, a number of time stamp counter increments,
+   into nanoseconds.  Before timer_calibrate() has run, the
+   result is 0. */
+int64_t
+timer_cycles_to_ns (uint64_t cycles)
+{
+  uint64_t cps = cycles_per_sec;
+
+  if (cps == 0)
+    return 0;
+
+  /* Split the multiplication by 1e9 so that it cannot overflow
+     for any realistic uptime. */
+  return (cycles / cps * 1000000000
+          + cycles % cps * 1000000000 / cps);
+}
+
+/* Returns the time in nanoseconds, measured from an arbitrary
+   point at or before boot.  Resolution is that of the time stamp
+   counter, typically well under a nanosecond, so this is
+   suitable for timing short operations.  Before timer_calibrate()
+   has run, falls back to timer tick resolution. */
+int64_t
+timer_ns (void)
+{
+  if (cycles_per_sec == 0)
+    return timer_ticks () * (1000000000 / TIMER_FREQ);
+  return timer_cycles_to_ns (timer_cycles ());
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
@@ -164,13 +244,15 @@ void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %"PRIu64" cycles/s\n", cycles_per_sec);
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
   ticks++;
+  profile_sample (args);
   thread_tick ();
 }
 
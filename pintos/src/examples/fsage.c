@@ -0,0 +1,172 @@
+/* fsage.c
+
+   Ages the file system, so that allocator changes can be judged
+   against a disk that has seen use instead of a fresh one.
+   Repeatedly creates, grows, and deletes files of mixed sizes
+   spread across several directories, and reports fragmentation
+   with the fragstat system call as it goes.  The aged files are
+   left in place for later benchmarks, such as fsbench.
+
+   usage: fsage [ROUNDS [SEED]] */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define DIR_CNT 4               /* Directories to spread files over. */
+#define SLOT_CNT 32             /* Most files alive at once. */
+#define CHUNK 4096              /* Largest single write. */
+
+/* A file that may exist. */
+struct slot
+  {
+    bool exists;
+    int size;
+  };
+
+static struct slot slots[SLOT_CNT];
+static char buffer[CHUNK];
+
+/* Writes the name of the file in SLOT into NAME. */
+static void
+slot_name (char name[32], int slot)
+{
+  snprintf (name, 32, "/age%d/f%d", slot % DIR_CNT, slot);
+}
+
+/* Returns a random file size: mostly small files, some medium,
+   and a few large ones, as on a typical disk. */
+static int
+random_size (void)
+{
+  int kind = random_ulong () % 100;
+
+  if (kind < 70)
+    return 512 + random_ulong () % (4 * 1024);
+  else if (kind < 95)
+    return 4 * 1024 + random_ulong () % (28 * 1024);
+  else
+    return 32 * 1024 + random_ulong () % (96 * 1024);
+}
+
+/* Appends SIZE bytes to the file named NAME.  Returns false if
+   the disk filled up. */
+static bool
+append (const char *name, int size)
+{
+  int fd = open (name);
+  bool ok = true;
+
+  if (fd < 0)
+    return false;
+  seek (fd, filesize (fd));
+  while (size > 0 && ok)
+    {
+      int chunk = size < CHUNK ? size : CHUNK;
+      ok = write (fd, buffer, chunk) == chunk;
+      size -= chunk;
+    }
+  close (fd);
+  return ok;
+}
+
+/* Deletes the file in SLOT. */
+static void
+delete (int slot)
+{
+  char name[32];
+
+  slot_name (name, slot);
+  remove (name);
+  slots[slot].exists = false;
+}
+
+/* Does one random operation on a random slot. */
+static void
+age_step (void)
+{
+  int slot = random_ulong () % SLOT_CNT;
+  struct slot *s = &slots[slot];
+  char name[32];
+
+  slot_name (name, slot);
+  if (!s->exists)
+    {
+      int size = random_size ();
+      if (!create (name, 0))
+        return;
+      s->exists = true;
+      s->size = 0;
+      if (append (name, size))
+        s->size = size;
+      else
+        delete (slot);
+    }
+  else if (random_ulong () % 2 == 0)
+    {
+      /* Grow by a fraction of the current size, as logs and
+         documents do. */
+      int size = 512 + random_ulong () % (s->size / 2 + 1);
+      if (append (name, size))
+        s->size += size;
+      else
+        delete (slot);
+    }
+  else
+    delete (slot);
+}
+
+/* Prints a fragmentation report labeled with ROUND. */
+static void
+report (int round)
+{
+  struct fragstat st;
+
+  if (!fragstat (&st))
+    {
+      printf ("fsage: fragstat failed\n");
+      exit (EXIT_FAILURE);
+    }
+  printf ("fsage: round %d: %u files, %u fragmented, "
+          "%u sectors in %u extents\n",
+          round, st.file_cnt, st.fragmented_cnt,
+          st.data_sectors, st.extents);
+  printf ("fsage: round %d: %u free sectors in %u extents, "
+          "largest %u, index %u.%03u\n",
+          round, st.free_sectors, st.free_extents, st.largest_free,
+          st.free_frag_index / 1000, st.free_frag_index % 1000);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int rounds = argc > 1 ? atoi (argv[1]) : 200;
+  int seed = argc > 2 ? atoi (argv[2]) : 1;
+  int i;
+
+  if (rounds <= 0 || argc > 3)
+    {
+      printf ("usage: fsage [ROUNDS [SEED]]\n");
+      return EXIT_FAILURE;
+    }
+  random_init (seed);
+  memset (buffer, 'x', sizeof buffer);
+
+  for (i = 0; i < DIR_CNT; i++)
+    {
+      char name[32];
+      snprintf (name, sizeof name, "/age%d", i);
+      mkdir (name);
+    }
+
+  report (0);
+  for (i = 1; i <= rounds; i++)
+    {
+      age_step ();
+      if (i % (rounds / 4 > 0 ? rounds / 4 : 1) == 0)
+        report (i);
+    }
+  return EXIT_SUCCESS;
+}
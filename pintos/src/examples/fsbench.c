@@ -0,0 +1,384 @@
+/* fsbench.c
+
+   Measures file system throughput and latency, in the style of
+   fio.  Each job creates and fills a file of its own, then times
+   a series of block-sized reads or writes to it with the
+   nanotime system call.
+
+   usage: fsbench [-p PATTERN] [-b BLOCK] [-s SIZE] [-n OPS]
+                  [-j JOBS] [-m READ-PCT]
+
+   PATTERN is one of seqread, seqwrite, randread, randwrite, or
+   mixed, which does random reads and writes, READ-PCT percent of
+   them reads.  BLOCK and SIZE are in bytes and may end in "k" or
+   "m".  With more than one job, each job runs in a child
+   process of its own and reports its results to the parent
+   through a file. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define MAX_BLOCK (64 * 1024)   /* Largest block size. */
+#define MAX_JOBS 8              /* Most concurrent jobs. */
+
+/* Latency histogram.  Latencies below 4 ns get a bucket each;
+   each larger power of 2 is split into 4 buckets, for a
+   resolution of 25% or better. */
+#define HIST_BUCKETS 256
+
+enum pattern
+  {
+    SEQREAD, SEQWRITE, RANDREAD, RANDWRITE, MIXED
+  };
+
+static const char *pattern_names[] =
+  {
+    "seqread", "seqwrite", "randread", "randwrite", "mixed"
+  };
+
+/* Benchmark configuration. */
+static enum pattern pattern = SEQREAD;
+static int block_size = 4096;
+static int file_size = 256 * 1024;
+static int op_cnt;              /* 0 means file_size / block_size. */
+static int job_cnt = 1;
+static int read_pct = 50;
+
+/* Results of one or more jobs. */
+struct result
+  {
+    int64_t ops;                /* Operations done. */
+    int64_t bytes;              /* Bytes transferred. */
+    int64_t ns;                 /* Elapsed time. */
+    int64_t max_ns;             /* Slowest operation. */
+    uint32_t hist[HIST_BUCKETS]; /* Latency histogram. */
+  };
+
+static char buffer[MAX_BLOCK];
+
+/* Returns the histogram bucket for a latency of NS. */
+static int
+hist_bucket (int64_t ns)
+{
+  int log;
+
+  if (ns < 4)
+    return ns < 0 ? 0 : ns;
+  for (log = 2; log < 63 && ns >> (log + 1) != 0; log++)
+    continue;
+  return 4 * (log - 1) + ((ns >> (log - 2)) & 3);
+}
+
+/* Returns the largest latency that falls in BUCKET. */
+static int64_t
+hist_limit (int bucket)
+{
+  int log, sub;
+
+  if (bucket < 4)
+    return bucket;
+  log = bucket / 4 + 1;
+  sub = bucket % 4;
+  return ((int64_t) (4 + sub + 1) << (log - 2)) - 1;
+}
+
+/* Returns the latency below which PCT percent of the operations
+   in R completed, to the resolution of the histogram. */
+static int64_t
+percentile (const struct result *r, int pct)
+{
+  int64_t want = (r->ops * pct + 99) / 100;
+  int64_t seen = 0;
+  int i;
+
+  for (i = 0; i < HIST_BUCKETS; i++)
+    {
+      seen += r->hist[i];
+      if (seen >= want && seen > 0)
+        return hist_limit (i) < r->max_ns ? hist_limit (i) : r->max_ns;
+    }
+  return r->max_ns;
+}
+
+/* Writes the name of job JOB's data file, or its result file if
+   RESULT is true, into NAME. */
+static void
+job_file_name (char name[16], int job, bool result)
+{
+  snprintf (name, 16, "fsb-%s%d", result ? "r" : "", job);
+}
+
+/* Creates the data file for JOB and fills it, so that reads find
+   allocated data.  Returns its file descriptor. */
+static int
+setup_file (int job)
+{
+  char name[16];
+  int fd, ofs;
+
+  job_file_name (name, job, false);
+  remove (name);
+  if (!create (name, file_size))
+    {
+      printf ("fsbench: %s: create failed\n", name);
+      exit (EXIT_FAILURE);
+    }
+  fd = open (name);
+  if (fd < 0)
+    {
+      printf ("fsbench: %s: open failed\n", name);
+      exit (EXIT_FAILURE);
+    }
+  memset (buffer, 'a' + job, block_size);
+  for (ofs = 0; ofs < file_size; ofs += block_size)
+    write (fd, buffer, block_size);
+  return fd;
+}
+
+/* Runs job JOB and stores its results in R. */
+static void
+run_job (int job, struct result *r)
+{
+  int blocks = file_size / block_size;
+  int fd = setup_file (job);
+  int64_t start;
+  int i;
+
+  random_init (job + 1);
+  memset (r, 0, sizeof *r);
+  start = nanotime ();
+  for (i = 0; i < op_cnt; i++)
+    {
+      bool is_read;
+      int block, bytes;
+      int64_t op_start, ns;
+
+      if (pattern == SEQREAD || pattern == SEQWRITE)
+        block = i % blocks;
+      else
+        block = random_ulong () % blocks;
+      if (pattern == MIXED)
+        is_read = (int) (random_ulong () % 100) < read_pct;
+      else
+        is_read = pattern == SEQREAD || pattern == RANDREAD;
+
+      op_start = nanotime ();
+      seek (fd, block * block_size);
+      bytes = (is_read
+               ? read (fd, buffer, block_size)
+               : write (fd, buffer, block_size));
+      ns = nanotime () - op_start;
+
+      if (bytes != block_size)
+        {
+          printf ("fsbench: job %d: %s at offset %d returned %d\n", job,
+                  is_read ? "read" : "write", block * block_size, bytes);
+          exit (EXIT_FAILURE);
+        }
+      r->ops++;
+      r->bytes += bytes;
+      r->hist[hist_bucket (ns)]++;
+      if (ns > r->max_ns)
+        r->max_ns = ns;
+    }
+  r->ns = nanotime () - start;
+  close (fd);
+}
+
+/* Adds the results in B into A.  Jobs run concurrently, so the
+   combined elapsed time is that of the slowest job. */
+static void
+merge_result (struct result *a, const struct result *b)
+{
+  int i;
+
+  a->ops += b->ops;
+  a->bytes += b->bytes;
+  if (b->ns > a->ns)
+    a->ns = b->ns;
+  if (b->max_ns > a->max_ns)
+    a->max_ns = b->max_ns;
+  for (i = 0; i < HIST_BUCKETS; i++)
+    a->hist[i] += b->hist[i];
+}
+
+/* Runs job JOB in a child process and saves its results to its
+   result file. */
+static void
+child_main (int job)
+{
+  struct result r;
+  char name[16];
+  int fd;
+
+  run_job (job, &r);
+  job_file_name (name, job, true);
+  remove (name);
+  if (!create (name, sizeof r) || (fd = open (name)) < 0)
+    {
+      printf ("fsbench: %s: create failed\n", name);
+      exit (EXIT_FAILURE);
+    }
+  write (fd, &r, sizeof r);
+  close (fd);
+}
+
+/* Runs every job in a child process of its own and combines
+   their results into R. */
+static void
+run_children (const char *program, struct result *r)
+{
+  pid_t pids[MAX_JOBS];
+  int job;
+
+  for (job = 0; job < job_cnt; job++)
+    {
+      char cmd_line[128];
+
+      snprintf (cmd_line, sizeof cmd_line,
+                "%s -c %d -p %s -b %d -s %d -n %d -m %d", program, job,
+                pattern_names[pattern], block_size, file_size, op_cnt,
+                read_pct);
+      pids[job] = exec (cmd_line);
+      if (pids[job] == PID_ERROR)
+        {
+          printf ("fsbench: exec of job %d failed\n", job);
+          exit (EXIT_FAILURE);
+        }
+    }
+
+  memset (r, 0, sizeof *r);
+  for (job = 0; job < job_cnt; job++)
+    {
+      struct result child;
+      char name[16];
+      int fd;
+
+      if (wait (pids[job]) != 0)
+        {
+          printf ("fsbench: job %d failed\n", job);
+          exit (EXIT_FAILURE);
+        }
+      job_file_name (name, job, true);
+      fd = open (name);
+      if (fd < 0 || read (fd, &child, sizeof child) != sizeof child)
+        {
+          printf ("fsbench: %s: missing results\n", name);
+          exit (EXIT_FAILURE);
+        }
+      close (fd);
+      remove (name);
+      merge_result (r, &child);
+    }
+}
+
+/* Prints the results in R. */
+static void
+report (const struct result *r)
+{
+  int64_t us = r->ns / 1000 > 0 ? r->ns / 1000 : 1;
+
+  /* Bytes per microsecond are MB/s.  Divide by the time before
+     scaling to MiB/s, so that long runs cannot overflow. */
+  int64_t centi_mbps = r->bytes * 100 / us * 1000000 / (1024 * 1024);
+
+  printf ("fsbench: %s bs=%d size=%d jobs=%d", pattern_names[pattern],
+          block_size, file_size, job_cnt);
+  if (pattern == MIXED)
+    printf (" read=%d%%", read_pct);
+  printf ("\n");
+  printf ("fsbench: %lld ops, %lld bytes in %lld us\n",
+          r->ops, r->bytes, r->ns / 1000);
+  printf ("fsbench: %lld.%02lld MB/s, %lld ops/s\n",
+          centi_mbps / 100, centi_mbps % 100, r->ops * 1000000 / us);
+  printf ("fsbench: latency us p50 %lld p90 %lld p99 %lld max %lld\n",
+          percentile (r, 50) / 1000, percentile (r, 90) / 1000,
+          percentile (r, 99) / 1000, r->max_ns / 1000);
+}
+
+/* Parses SIZE, a number of bytes optionally followed by "k" or
+   "m". */
+static int
+parse_size (const char *size)
+{
+  int n = atoi (size);
+  const char *suffix = size + strspn (size, "0123456789");
+
+  if (*suffix == 'k' || *suffix == 'K')
+    n *= 1024;
+  else if (*suffix == 'm' || *suffix == 'M')
+    n *= 1024 * 1024;
+  return n;
+}
+
+static void
+usage (void)
+{
+  printf ("usage: fsbench [-p PATTERN] [-b BLOCK] [-s SIZE] [-n OPS]\n"
+          "               [-j JOBS] [-m READ-PCT]\n"
+          "PATTERN is seqread, seqwrite, randread, randwrite, or mixed.\n");
+  exit (EXIT_FAILURE);
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct result r;
+  int child = -1;
+  int i;
+
+  for (i = 1; i < argc; i++)
+    {
+      const char *arg = argv[i + 1];
+
+      if (arg == NULL || argv[i][0] != '-' || argv[i][2] != '\0')
+        usage ();
+      switch (argv[i++][1])
+        {
+        case 'p':
+          for (pattern = 0; pattern <= MIXED; pattern++)
+            if (!strcmp (arg, pattern_names[pattern]))
+              break;
+          if (pattern > MIXED)
+            usage ();
+          break;
+        case 'b': block_size = parse_size (arg); break;
+        case 's': file_size = parse_size (arg); break;
+        case 'n': op_cnt = atoi (arg); break;
+        case 'j': job_cnt = atoi (arg); break;
+        case 'm': read_pct = atoi (arg); break;
+        case 'c': child = atoi (arg); break;
+        default: usage ();
+        }
+    }
+  if (block_size <= 0 || block_size > MAX_BLOCK
+      || file_size < block_size || file_size % block_size != 0
+      || job_cnt < 1 || job_cnt > MAX_JOBS
+      || read_pct < 0 || read_pct > 100 || op_cnt < 0)
+    usage ();
+  if (op_cnt == 0)
+    op_cnt = file_size / block_size;
+
+  if (child >= 0)
+    {
+      child_main (child);
+      return EXIT_SUCCESS;
+    }
+
+  if (job_cnt == 1)
+    run_job (0, &r);
+  else
+    run_children (argv[0], &r);
+  report (&r);
+
+  for (i = 0; i < job_cnt; i++)
+    {
+      char name[16];
+      job_file_name (name, i, false);
+      remove (name);
+    }
+  return EXIT_SUCCESS;
+}
@@ -1,13 +1,31 @@
 #include <stdio.h>
 #include <string.h>
 #include "filesys/cache.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "filesys/filesys.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
+
+/* Cache of buffer cache entries. */
+static struct kmem_cache *entry_cache;
+
+static void cache_write_back (struct cache_entry *entry);
+
+/* Constructs cache entry ENTRY_ for entry_cache. */
+static void cache_entry_ctor (void *entry_)
+{
+	struct cache_entry *entry = entry_;
+	lock_init(&entry->cache_entry_lock);
+}
 
 void cache_init (void)
 {
+	entry_cache = kmem_cache_create("cache entry", sizeof(struct cache_entry), cache_entry_ctor);
+	if (entry_cache == NULL)
+		PANIC("buffer cache creation failed");
 	list_init(&cache);
 	lock_init(&global_cache_lock);
+	lock_set_name(&global_cache_lock, "buffer cache");
 	cache_size = 0;
 }
 
@@ -22,6 +40,7 @@ struct cache_entry * cache_get_entry (block_sector_t sector)
 		entry = list_entry(elem, struct cache_entry, cache_list_elem);
 		if (entry->block_sector == sector) {
 			entry->pin = 1;
+			trace(TRACE_CACHE, TRACE_CACHE_HIT, sector, 0);
 			lock_release(&global_cache_lock);
 			return entry;
 		}
@@ -35,12 +54,14 @@ struct cache_entry * cache_get_entry (block_sector_t sector)
 		copy from disk to new entry
 		cache_size++ */
 	struct cache_entry *return_entry;
+	trace(TRACE_CACHE, TRACE_CACHE_MISS, sector, 0);
 	if (cache_size < 64) {
-		return_entry = malloc(sizeof(struct cache_entry));
+		return_entry = kmem_cache_alloc(entry_cache);
 		block_read(fs_device, sector, &return_entry->data);
 		return_entry->block_sector = sector;
 		return_entry->pin = 1;
 		return_entry->dirty = false;
+		return_entry->io_inode = TRACE_NO_INODE;
 		return_entry->threads_reading = 0;
 		list_push_back(&cache, &return_entry->cache_list_elem);
 		cache_size++;
@@ -66,6 +87,8 @@ struct cache_entry * cache_clock_evict_and_replace (block_sector_t new_sector) {
 		temp_cache_entry = list_entry(clock_hand_elem, struct cache_entry, cache_list_elem);
 
 		if (temp_cache_entry->pin == 0) {
+			trace(TRACE_CACHE, TRACE_CACHE_EVICT, temp_cache_entry->block_sector,
+				  temp_cache_entry->dirty);
 			if (temp_cache_entry->dirty == true) {
 				cache_flush_clock_entry ();
 			}
@@ -105,7 +128,31 @@ writes cache_entry indicated by clock_hand_elem to disk
 */
 void cache_flush_clock_entry (void) {
 	struct cache_entry *temp_cache_entry = list_entry(clock_hand_elem, struct cache_entry, cache_list_elem);
-	block_write(fs_device, temp_cache_entry->block_sector, &temp_cache_entry->data);
+	cache_write_back(temp_cache_entry);
+}
+
+/*
+marks ENTRY dirty, remembering the inode that the running thread is
+reading or writing, so that the eventual write-back is traced
+against that inode rather than whichever one the flushing thread
+happens to be working on
+*/
+void cache_mark_dirty (struct cache_entry *entry) {
+	entry->dirty = true;
+	entry->io_inode = thread_current()->io_inode;
+}
+
+/*
+writes ENTRY back to disk, charging the write to the inode that
+dirtied it in the block trace
+*/
+static void cache_write_back (struct cache_entry *entry) {
+	struct thread *t = thread_current();
+	uint32_t old_io_inode = t->io_inode;
+
+	t->io_inode = entry->io_inode;
+	block_write(fs_device, entry->block_sector, entry->data);
+	t->io_inode = old_io_inode;
 }
 
 /*
@@ -119,13 +166,13 @@ void cache_flush_all (void) {
 	while (elem != list_end(&cache)) {
 		entry = list_entry(elem, struct cache_entry, cache_list_elem);
 		if (entry->dirty == true) {
-			block_write(fs_device, entry->block_sector, entry->data);
+			cache_write_back(entry);
 		}
 		elem = list_next(elem);
 	}
 	while (!list_empty(&cache)) {
 		struct list_elem *removed = list_pop_front(&cache);
-		free(list_entry(removed, struct cache_entry, cache_list_elem));
+		kmem_cache_free(entry_cache, list_entry(removed, struct cache_entry, cache_list_elem));
 	}
 }
 
@@ -136,6 +183,7 @@ void cache_read_sector_to_clock_sector(block_sector_t new_sector) {
 	struct cache_entry *temp_cache_entry = list_entry(clock_hand_elem, struct cache_entry, cache_list_elem);
 	block_read(fs_device, new_sector, &temp_cache_entry->data);
 	temp_cache_entry->dirty = false;
+	temp_cache_entry->io_inode = TRACE_NO_INODE;
 	temp_cache_entry->pin = 1;
 	temp_cache_entry->block_sector = new_sector;
 }
@@ -13,6 +13,7 @@ struct cache_entry {
 	bool dirty; 			/* True if cache has been written to. */
 	int pin;			/* Pin value for clock replacement. */
 	block_sector_t block_sector;			/* The number of the cache entry’s sector. */
+	uint32_t io_inode;		/* Inode that last dirtied the entry, for tracing. */
 	struct lock cache_entry_lock;		/* Lock specific to each cache for synchronization. */
 	struct list_elem cache_list_elem;		/* Used to make cache entry a member of a struct list */
 	uint8_t data[BLOCK_SECTOR_SIZE];		/* List to hold the data of the cache entry */
@@ -20,6 +21,7 @@ struct cache_entry {
 
 void cache_init(void); // initializes buffer cache
 struct cache_entry * cache_get_entry (block_sector_t sector);
+void cache_mark_dirty (struct cache_entry *entry); // marks entry dirty on behalf of the running thread's io_inode
 void cache_write_sector (block_sector_t sector, void* buffer); // buffer cache is always writeback, don't need separate method for writeback
 // void cache_allocate (block_sector_t sector); // not sure if we need this. use case: initialize an entry in the cache table
 // void cache_add (block_sector_t sector); // adding in a new sector, will use evict to evict a sector if necessary
@@ -12,7 +12,12 @@
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* Deepest directory nesting examined by filesys_fragstat(). */
+#define FRAGSTAT_MAX_DEPTH 16
+
 static void do_format (void);
+static void fragstat_inode (struct inode *, struct fragstat *);
+static void fragstat_dir (struct dir *, struct fragstat *, int depth);
 struct dir* get_dir (const char *path, bool to_remove, bool chdir);
 char* get_filename (const char *path);
 bool path_is_dir (const char *path);
@@ -27,6 +32,8 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
+  dir_init ();
   free_map_init ();
   cache_init ();
 
@@ -148,6 +155,75 @@ filesys_chdir (const char *name)
   current->cwd = dir;
   return true;
 }
+
+/* Fills in ST with a fragmentation report for the file system:
+   the extents of every file and directory reachable from the
+   root, and the runs of free sectors in the free map. */
+void
+filesys_fragstat (struct fragstat *st)
+{
+  struct dir *root;
+  size_t free_cnt, run_cnt, largest;
+
+  memset (st, 0, sizeof *st);
+  root = dir_open_root ();
+  if (root != NULL)
+    {
+      fragstat_inode (dir_get_inode (root), st);
+      fragstat_dir (root, st, 0);
+      dir_close (root);
+    }
+
+  free_map_frag (&free_cnt, &run_cnt, &largest);
+  st->free_sectors = free_cnt;
+  st->free_extents = run_cnt;
+  st->largest_free = largest;
+  st->free_frag_index = (free_cnt > 0
+                         ? 1000 - (uint64_t) largest * 1000 / free_cnt
+                         : 0);
+}
+
+/* Adds INODE's extents to ST. */
+static void
+fragstat_inode (struct inode *inode, struct fragstat *st)
+{
+  size_t sectors;
+  size_t extents = inode_extent_cnt (inode, &sectors);
+
+  st->file_cnt++;
+  st->data_sectors += sectors;
+  st->extents += extents;
+  if (extents > 1)
+    st->fragmented_cnt++;
+}
+
+/* Adds the extents of every file under DIR, which is DEPTH levels
+   below the root, to ST. */
+static void
+fragstat_dir (struct dir *dir, struct fragstat *st, int depth)
+{
+  char name[NAME_MAX + 1];
+
+  while (dir_readdir (dir, name))
+    {
+      struct inode *inode;
+
+      if (!dir_lookup (dir, name, &inode))
+        continue;
+      fragstat_inode (inode, st);
+      if (inode_is_dir (inode) && depth < FRAGSTAT_MAX_DEPTH)
+        {
+          struct dir *subdir = dir_open (inode);
+          if (subdir != NULL)
+            {
+              fragstat_dir (subdir, st, depth + 1);
+              dir_close (subdir);
+            }
+        }
+      else
+        inode_close (inode);
+    }
+}
 
 /* Formats the file system. */
 static void
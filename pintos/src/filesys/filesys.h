@@ -2,6 +2,7 @@
 #define FILESYS_FILESYS_H
 
 #include <stdbool.h>
+#include <fragstat.h>
 #include "filesys/off_t.h"
 
 /* Sectors of system file inodes. */
@@ -17,5 +18,6 @@ bool filesys_create (const char *name, off_t initial_size, bool is_dir);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
 bool filesys_chdir (const char *name);
+void filesys_fragstat (struct fragstat *);
 
 #endif /* filesys/filesys.h */
@@ -49,6 +49,31 @@ free_map_release (block_sector_t sector, size_t cnt)
   bitmap_write (free_map, free_map_file);
 }
 
+/* Summarizes fragmentation of free space: stores the number of
+   free sectors into *FREE_CNT, the number of runs of contiguous
+   free sectors into *RUN_CNT, and the length of the longest run
+   into *LARGEST. */
+void
+free_map_frag (size_t *free_cnt, size_t *run_cnt, size_t *largest)
+{
+  size_t sector_cnt = bitmap_size (free_map);
+  size_t run = 0;
+  size_t i;
+
+  *free_cnt = *run_cnt = *largest = 0;
+  for (i = 0; i < sector_cnt; i++)
+    if (!bitmap_test (free_map, i))
+      {
+        if (run++ == 0)
+          ++*run_cnt;
+        ++*free_cnt;
+        if (run > *largest)
+          *largest = run;
+      }
+    else
+      run = 0;
+}
+
 /* Opens the free map file and reads it from disk. */
 void
 free_map_open (void)
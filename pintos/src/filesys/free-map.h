@@ -13,5 +13,6 @@ void free_map_close (void);
 
 bool free_map_allocate (size_t, block_sector_t *);
 void free_map_release (block_sector_t, size_t);
+void free_map_frag (size_t *free_cnt, size_t *run_cnt, size_t *largest);
 
 #endif /* filesys/free-map.h */
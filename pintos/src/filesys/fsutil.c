@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -66,6 +67,25 @@ fsutil_rm (char **argv)
     PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Prints a fragmentation report for the file system. */
+void
+fsutil_frag (char **argv UNUSED)
+{
+  struct fragstat st;
+
+  filesys_fragstat (&st);
+  printf ("File system fragmentation:\n");
+  printf ("  %"PRIu32" files, %"PRIu32" fragmented\n",
+          st.file_cnt, st.fragmented_cnt);
+  printf ("  %"PRIu32" data sectors in %"PRIu32" extents\n",
+          st.data_sectors, st.extents);
+  printf ("  %"PRIu32" free sectors in %"PRIu32" extents, "
+          "largest %"PRIu32"\n",
+          st.free_sectors, st.free_extents, st.largest_free);
+  printf ("  free space fragmentation index %"PRIu32".%03"PRIu32"\n",
+          st.free_frag_index / 1000, st.free_frag_index % 1000);
+}
+
 /* Extracts a ustar-format tar archive from the scratch block
    device into the Pintos file system. */
 void
@@ -7,7 +7,9 @@
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
 #include "filesys/cache.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -67,6 +69,10 @@ struct inode
     struct lock inode_lock;             /* Lock in order to operate on inode. */
   };
 
+/* Caches of in-memory inodes and inode indexes. */
+static struct kmem_cache *inode_cache;
+static struct kmem_cache *index_cache;
+
 /* Returns the block device sector that contains byte offset POS
    within INODE.
    Returns -1 if INODE does not contain data for a byte at offset
@@ -93,7 +99,7 @@ byte_to_sector (const struct inode *inode, off_t pos)
         index_num = final_pointers->pointers[index->index];
       }
     }
-    free(index);
+    kmem_cache_free (index_cache, index);
   }
   return index_num;
 }
@@ -102,7 +108,7 @@ byte_to_sector (const struct inode *inode, off_t pos)
 struct inode_index *
 inode_index (off_t pos)
 {
-  struct inode_index *inode_index = malloc(sizeof(inode_index));
+  struct inode_index *inode_index = kmem_cache_alloc (index_cache);
   int num = pos / BLOCK_SECTOR_SIZE;
   inode_index->valid = false;
   if (num < DIR_PTRS) {
@@ -125,15 +131,52 @@ inode_index (off_t pos)
   return inode_index;
 }
 
+/* Walks INODE's block map and returns the number of runs of
+   contiguous sectors that hold its data, a measure of how
+   fragmented it is.  Stores the number of data sectors into
+   *SECTOR_CNT. */
+size_t
+inode_extent_cnt (const struct inode *inode, size_t *sector_cnt)
+{
+  size_t sectors = bytes_to_sectors (inode->data.length);
+  block_sector_t prev = 0;
+  size_t extents = 0;
+  size_t i;
+
+  for (i = 0; i < sectors; i++)
+    {
+      block_sector_t sector = byte_to_sector (inode, i * BLOCK_SECTOR_SIZE);
+      if (i == 0 || sector != prev + 1)
+        extents++;
+      prev = sector;
+    }
+  *sector_cnt = sectors;
+  return extents;
+}
+
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Constructs in-memory inode INODE_ for inode_cache. */
+static void
+inode_ctor (void *inode_)
+{
+  struct inode *inode = inode_;
+  lock_init (&inode->inode_lock);
+}
+
 /* Initializes the inode module. */
 void
 inode_init (void)
 {
   list_init (&open_inodes);
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode),
+                                   inode_ctor);
+  index_cache = kmem_cache_create ("inode index",
+                                   sizeof (struct inode_index), NULL);
+  if (inode_cache == NULL || index_cache == NULL)
+    PANIC ("inode cache creation failed");
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -146,6 +189,7 @@ inode_create (block_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
   bool success = false;
+  uint32_t old_io_inode;
 
   ASSERT (length >= 0);
 
@@ -157,6 +201,8 @@ inode_create (block_sector_t sector, off_t length, bool is_dir)
 
   if (disk_inode == NULL)
     return false;
+  old_io_inode = thread_current ()->io_inode;
+  thread_current ()->io_inode = sector;
   disk_inode->length = length;
   disk_inode->magic = INODE_MAGIC;
   disk_inode->is_dir = is_dir;
@@ -182,7 +228,7 @@ inode_create (block_sector_t sector, off_t length, bool is_dir)
           free_map_allocate(1, &inode_sector);
           pointers->pointers[j] = inode_sector;
         }
-        indirect_entry->dirty = true;
+        cache_mark_dirty (indirect_entry);
       } else {
         free_map_allocate(1, &inode_sector);
         disk_inode->doubly_indirect = inode_sector;
@@ -199,17 +245,18 @@ inode_create (block_sector_t sector, off_t length, bool is_dir)
             free_map_allocate(1, &inode_sector);
             double_pointers->pointers[k] = inode_sector;
           }
-          doubly_indirect_entry->dirty = true;
+          cache_mark_dirty (doubly_indirect_entry);
         }
-        indirect_entry->dirty = true;
+        cache_mark_dirty (indirect_entry);
       }
     }
   }
 
   struct cache_entry *entry = cache_get_entry (sector);
   memcpy(&entry->data, disk_inode, BLOCK_SECTOR_SIZE);
-  entry->dirty = true;
+  cache_mark_dirty (entry);
   free (disk_inode);
+  thread_current ()->io_inode = old_io_inode;
   return true;
 }
 
@@ -235,7 +282,7 @@ inode_open (block_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -245,7 +292,6 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  lock_init(&inode->inode_lock);
   struct cache_entry *entry = cache_get_entry (sector);
   memcpy(&inode->data, &entry->data, BLOCK_SECTOR_SIZE);
   return inode;
@@ -298,6 +344,7 @@ inode_close (struct inode *inode)
               struct block_of_pointers *pointers = (struct block_of_pointers *) indirect_entry->data;
               struct inode_index *index = inode_index(i * 4);
               free_map_release(pointers->pointers[index->index], 1);
+              kmem_cache_free (index_cache, index);
               indirect = true;
             } else {
               struct cache_entry *doubly_indirect_entry = cache_get_entry(inode->sector);
@@ -306,6 +353,7 @@ inode_close (struct inode *inode)
               struct cache_entry *final_entry = cache_get_entry(pointers->pointers[index->double_index]);
               struct block_of_pointers *final_pointers = (struct block_of_pointers *) final_entry->data;
               free_map_release(final_pointers->pointers[index->index], 1);
+              kmem_cache_free (index_cache, index);
               double_indirect = true;
             }
           }
@@ -321,7 +369,7 @@ inode_close (struct inode *inode)
           }
 
         }
-      free (inode);
+      kmem_cache_free (inode_cache, inode);
     }
 }
 
@@ -342,6 +390,9 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
+  uint32_t old_io_inode = thread_current ()->io_inode;
+
+  thread_current ()->io_inode = inode->sector;
   while (size > 0)
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -366,6 +417,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  thread_current ()->io_inode = old_io_inode;
 
   return bytes_read;
 }
@@ -381,9 +433,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
+  uint32_t old_io_inode;
 
   if (inode->deny_write_cnt)
     return 0;
+  old_io_inode = thread_current ()->io_inode;
+  thread_current ()->io_inode = inode->sector;
   if (inode->data.length < offset+size) {
     int i;
     int sectors = bytes_to_sectors (offset + size);
@@ -408,7 +463,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
           free_map_allocate(1, &inode_sector);
           pointers->pointers[j] = inode_sector;
         }
-        entry->dirty = true;
+        cache_mark_dirty (entry);
       } else {
         free_map_allocate(1, &inode_sector);
         disk_inode->doubly_indirect = inode_sector;
@@ -423,15 +478,15 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
               free_map_allocate(1, &inode_sector);
               double_pointers->pointers[k] = inode_sector;
             }
-            doubly_indirect_entry->dirty = true;
+            cache_mark_dirty (doubly_indirect_entry);
         }
-        indirect_entry->dirty = true;
+        cache_mark_dirty (indirect_entry);
       }
     }
     disk_inode->length = offset+size;
     struct cache_entry *entry = cache_get_entry(inode->sector);
     memcpy(entry->data, disk_inode, 512);
-    entry->dirty = true;
+    cache_mark_dirty (entry);
   }
 
   while (size > 0)
@@ -452,13 +507,14 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
       struct cache_entry *entry = cache_get_entry (sector_idx);
       memcpy((uint8_t *) &entry->data + sector_ofs, buffer + bytes_written, chunk_size);
-      entry->dirty = true;
+      cache_mark_dirty (entry);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+  thread_current ()->io_inode = old_io_inode;
 
   return bytes_written;
 }
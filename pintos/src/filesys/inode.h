@@ -26,5 +26,6 @@ void inode_lock_release (struct inode *inode);
 block_sector_t inode_get_parent (struct inode *inode);
 bool inode_add_parent (block_sector_t child_sector, block_sector_t parent_sector);
 bool inode_still_open (struct inode *inode);
+size_t inode_extent_cnt (const struct inode *, size_t *sector_cnt);
 
 #endif /* filesys/inode.h */
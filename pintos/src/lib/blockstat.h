@@ -0,0 +1,49 @@
+#ifndef __LIB_BLOCKSTAT_H
+#define __LIB_BLOCKSTAT_H
+
+#include <stdint.h>
+
+/* I/O statistics for a block device, kept by the kernel and
+   returned to user programs by the blockstat system call. */
+
+/* Number of buckets in each histogram.  Bucket 0 counts values
+   of 0, bucket N counts values of 2**(N-1) to 2**N - 1, and the
+   last bucket also counts everything larger. */
+#define BLOCKSTAT_BUCKETS 16
+
+/* Type of a whole disk, BLOCK_RAW in devices/block.h.
+   devices/block.c checks at compile time that the two agree.
+   Devices of any other type are partitions, whose requests are
+   carried out, and also counted, by the disk that contains
+   them. */
+#define BLOCKSTAT_DISK 4
+
+struct blockstat
+  {
+    char name[16];              /* Device name, e.g. "hda1". */
+    uint32_t type;              /* enum block_type in devices/block.h. */
+    uint64_t read_cnt;          /* Sectors read. */
+    uint64_t write_cnt;         /* Sectors written. */
+    uint64_t read_bytes;        /* Bytes read. */
+    uint64_t write_bytes;       /* Bytes written. */
+    uint64_t service_ns;        /* Total time spent in the driver. */
+
+    /* The histograms are kept only for disks, so they are empty
+       for partitions. */
+
+    /* Service time of each request in microseconds, including any
+       wait for the channel lock. */
+    uint32_t service[BLOCKSTAT_BUCKETS];
+
+    /* Distance in sectors of each request from the sector after
+       the previous request, so bucket 0 counts sequential
+       requests and the rest count seeks. */
+    uint32_t seek[BLOCKSTAT_BUCKETS];
+
+    /* Reported by the disk driver, so zero for partitions. */
+    uint64_t lock_wait_ns;      /* Total wait for the channel lock. */
+    uint64_t max_lock_wait_ns;  /* Longest wait for the channel lock. */
+    uint32_t interrupts;        /* Completion interrupts. */
+  };
+
+#endif /* lib/blockstat.h */
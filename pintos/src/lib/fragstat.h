@@ -0,0 +1,25 @@
+#ifndef __LIB_FRAGSTAT_H
+#define __LIB_FRAGSTAT_H
+
+#include <stdint.h>
+
+/* File system fragmentation report, computed by the kernel by
+   walking every inode reachable from the root directory and the
+   free map, and returned to user programs by the fragstat system
+   call.  All counts are in sectors or runs of sectors. */
+struct fragstat
+  {
+    uint32_t file_cnt;          /* Files and directories examined. */
+    uint32_t fragmented_cnt;    /* Those with more than one extent. */
+    uint32_t data_sectors;      /* Sectors holding their data. */
+    uint32_t extents;           /* Runs of contiguous data sectors. */
+    uint32_t free_sectors;      /* Free sectors. */
+    uint32_t free_extents;      /* Runs of contiguous free sectors. */
+    uint32_t largest_free;      /* Longest run of free sectors. */
+    uint32_t free_frag_index;   /* Free space fragmentation index in
+                                   thousandths: 0 when all free space
+                                   is one run, approaching 1000 as it
+                                   is split into small runs. */
+  };
+
+#endif /* lib/fragstat.h */
@@ -0,0 +1,31 @@
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/* Scheduling statistics, kept by the kernel for every thread and
+   returned to user programs by the schedstat system call.  All
+   times are in timer ticks. */
+
+/* Passed to schedstat() instead of a pid to get totals for every
+   thread that has run since boot, live or dead. */
+#define SCHEDSTAT_ALL 0
+
+/* Number of buckets in the wakeup latency histogram.  Bucket 0
+   counts wakeups that ran within the same tick, bucket N counts
+   latencies of 2**(N-1) to 2**N - 1 ticks, and the last bucket
+   also counts everything longer. */
+#define SCHEDSTAT_BUCKETS 8
+
+struct schedstat
+  {
+    int64_t run_ticks;          /* Time spent running. */
+    int64_t ready_ticks;        /* Time spent waiting in a run queue. */
+    int64_t blocked_ticks;      /* Time spent blocked. */
+    uint32_t voluntary;         /* Blocked or yielded by choice. */
+    uint32_t involuntary;       /* Preempted at end of time slice. */
+    uint32_t wakeups;           /* Times unblocked. */
+    uint32_t latency[SCHEDSTAT_BUCKETS]; /* Wakeup-to-run latency. */
+  };
+
+#endif /* lib/schedstat.h */
@@ -32,7 +32,14 @@ enum
     SYS_INUMBER,                /* Returns the inode number for a fd. */
 
     SYS_HITRATE,                /* Measures the hit rate of the cache. */
-    SYS_COALESCE                /* Makes sure writes are coalesced. */
+    SYS_COALESCE,               /* Makes sure writes are coalesced. */
+    SYS_SETTICKETS,             /* Sets stride scheduling tickets. */
+    SYS_SCHEDSTAT,              /* Reads scheduling statistics. */
+    SYS_PROFILE,                /* Starts or stops the CPU profiler. */
+    SYS_TRACEDUMP,              /* Drains the kernel event trace. */
+    SYS_NANOTIME,               /* Reads the high-resolution clock. */
+    SYS_FRAGSTAT,               /* Reports file system fragmentation. */
+    SYS_BLOCKSTAT               /* Reads block device statistics. */
   };
 
 #endif /* lib/syscall-nr.h */
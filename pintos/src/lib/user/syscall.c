@@ -201,3 +201,46 @@ coalesce (int fd, void *buffer, unsigned size)
   return syscall3 (SYS_COALESCE, fd, buffer, size);
 }
 
+int
+settickets (int tickets)
+{
+  return syscall1 (SYS_SETTICKETS, tickets);
+}
+
+bool
+schedstat (pid_t pid, struct schedstat *st)
+{
+  return syscall2 (SYS_SCHEDSTAT, pid, st);
+}
+
+int
+profile (bool enable)
+{
+  return syscall1 (SYS_PROFILE, enable);
+}
+
+int
+tracedump (const char *file)
+{
+  return syscall1 (SYS_TRACEDUMP, file);
+}
+
+int64_t
+nanotime (void)
+{
+  int64_t ns;
+  syscall1 (SYS_NANOTIME, &ns);
+  return ns;
+}
+
+bool
+fragstat (struct fragstat *st)
+{
+  return syscall1 (SYS_FRAGSTAT, st);
+}
+
+bool
+blockstat (int idx, struct blockstat *st)
+{
+  return syscall2 (SYS_BLOCKSTAT, idx, st);
+}
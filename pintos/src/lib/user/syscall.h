@@ -3,6 +3,9 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <schedstat.h>
+#include <fragstat.h>
+#include <blockstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -48,5 +51,12 @@ int inumber (int fd);
 
 unsigned long long hitrate (int fd, void *buffer, unsigned length);
 bool coalesce (int fd, void *buffer, unsigned length);
+int settickets (int tickets);
+bool schedstat (pid_t, struct schedstat *);
+int profile (bool enable);
+int tracedump (const char *file);
+int64_t nanotime (void);
+bool fragstat (struct fragstat *);
+bool blockstat (int idx, struct blockstat *);
 
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,78 @@
+/* Benchmarks for the page and subpage allocators. */
+
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Each round allocates BATCH blocks and then frees them all, so
+   that the allocator has to go beyond its most recently freed
+   block. */
+#define BATCH 64
+#define MALLOC_ROUNDS 256
+#define PALLOC_ROUNDS 64
+
+/* Measures a malloc() and free() pair for each of malloc()'s
+   size classes, and for a block too big for any of them. */
+void
+bench_malloc (void)
+{
+  static void *blocks[BATCH];
+  size_t size;
+
+  for (size = 16; size <= PGSIZE; size *= 2)
+    {
+      char name[32];
+      int64_t start;
+      int round, i;
+
+      start = timer_ns ();
+      for (round = 0; round < MALLOC_ROUNDS; round++)
+        {
+          for (i = 0; i < BATCH; i++)
+            {
+              blocks[i] = malloc (size);
+              ASSERT (blocks[i] != NULL);
+            }
+          for (i = 0; i < BATCH; i++)
+            free (blocks[i]);
+        }
+      snprintf (name, sizeof name, "malloc-%zu", size);
+      bench_report (name, MALLOC_ROUNDS * BATCH, timer_ns () - start);
+    }
+}
+
+/* Runs PALLOC_ROUNDS rounds of getting and freeing BATCH pages
+   with FLAGS, and reports the result as NAME. */
+static void
+palloc_rounds (const char *name, enum palloc_flags flags)
+{
+  static void *pages[BATCH];
+  int64_t start;
+  int round, i;
+
+  start = timer_ns ();
+  for (round = 0; round < PALLOC_ROUNDS; round++)
+    {
+      for (i = 0; i < BATCH; i++)
+        {
+          pages[i] = palloc_get_page (flags);
+          ASSERT (pages[i] != NULL);
+        }
+      for (i = 0; i < BATCH; i++)
+        palloc_free_page (pages[i]);
+    }
+  bench_report (name, PALLOC_ROUNDS * BATCH, timer_ns () - start);
+}
+
+/* Measures a palloc_get_page() and palloc_free_page() pair,
+   with and without zeroing. */
+void
+bench_palloc (void)
+{
+  palloc_rounds ("palloc-get-page", 0);
+  palloc_rounds ("palloc-get-page-zero", PAL_ZERO);
+}
@@ -0,0 +1,70 @@
+/* Kernel microbenchmarks.
+
+   Each benchmark is run as a kernel action, e.g. "pintos run
+   bench-lock", and "bench-all" runs every benchmark in turn.
+   Results are printed one per line in the form
+
+        bench: NAME ITERATIONS TOTAL-NS NS-PER-OP
+
+   so that the output of two kernels can be compared with
+   utils/pintos-bench.  Times come from timer_ns(), so they are
+   only meaningful relative to other runs on the same host and
+   simulator. */
+
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+struct bench
+  {
+    const char *name;
+    bench_func *function;
+  };
+
+static const struct bench benches[] =
+  {
+    {"bench-ctxsw", bench_ctxsw},
+    {"bench-sema", bench_sema},
+    {"bench-lock", bench_lock},
+    {"bench-malloc", bench_malloc},
+    {"bench-palloc", bench_palloc},
+#ifdef FILESYS
+    {"bench-cache", bench_cache},
+    {"bench-ide", bench_ide},
+#endif
+  };
+
+#define BENCH_CNT (sizeof benches / sizeof *benches)
+
+/* Runs the benchmark named NAME, or all of them if NAME is
+   "bench-all". */
+void
+run_bench (const char *name)
+{
+  const struct bench *b;
+  bool all = !strcmp (name, "bench-all");
+  bool found = false;
+
+  for (b = benches; b < benches + BENCH_CNT; b++)
+    if (all || !strcmp (name, b->name))
+      {
+        printf ("(%s) begin\n", b->name);
+        b->function ();
+        printf ("(%s) end\n", b->name);
+        found = true;
+      }
+  if (!found)
+    PANIC ("no benchmark named \"%s\"", name);
+}
+
+/* Prints the result of a benchmark case NAME that ran
+   ITERATIONS operations in NS nanoseconds. */
+void
+bench_report (const char *name, int iterations, int64_t ns)
+{
+  ASSERT (iterations > 0);
+  printf ("bench: %s %d %"PRId64" %"PRId64"\n",
+          name, iterations, ns, ns / iterations);
+}
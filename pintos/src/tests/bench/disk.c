@@ -0,0 +1,78 @@
+/* Benchmarks for the buffer cache and the disk driver.  These
+   only read, so they do not disturb the file system. */
+
+#include "tests/bench/bench.h"
+#ifdef FILESYS
+#include <debug.h>
+#include <random.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+
+#define CACHE_HIT_ITERATIONS 10000
+#define CACHE_MISS_ITERATIONS 1024
+#define IDE_ITERATIONS 256
+
+/* Number of distinct sectors cycled through to make every
+   cache lookup miss.  Must exceed the cache's 64 entries. */
+#define MISS_SECTORS 128
+
+/* Returns the file system device, which must exist. */
+static struct block *
+bench_device (void)
+{
+  if (fs_device == NULL)
+    PANIC ("disk benchmarks need a file system disk");
+  return fs_device;
+}
+
+/* Measures cache_get_entry() when the sector is cached, and
+   when it is not. */
+void
+bench_cache (void)
+{
+  struct block *block = bench_device ();
+  block_sector_t sectors = block_size (block);
+  int64_t start;
+  int i;
+
+  ASSERT (sectors >= MISS_SECTORS);
+
+  cache_get_entry (0);
+  start = timer_ns ();
+  for (i = 0; i < CACHE_HIT_ITERATIONS; i++)
+    cache_get_entry (0);
+  bench_report ("cache-hit", CACHE_HIT_ITERATIONS, timer_ns () - start);
+
+  /* Clock replacement over a cyclic pattern twice the size of
+     the cache misses on every access. */
+  start = timer_ns ();
+  for (i = 0; i < CACHE_MISS_ITERATIONS; i++)
+    cache_get_entry (sectors - MISS_SECTORS + i % MISS_SECTORS);
+  bench_report ("cache-miss", CACHE_MISS_ITERATIONS, timer_ns () - start);
+}
+
+/* Measures block_read() latency on the file system disk,
+   bypassing the buffer cache, for sequential and random
+   sectors. */
+void
+bench_ide (void)
+{
+  static uint8_t buffer[BLOCK_SECTOR_SIZE];
+  struct block *block = bench_device ();
+  block_sector_t sectors = block_size (block);
+  int64_t start;
+  int i;
+
+  start = timer_ns ();
+  for (i = 0; i < IDE_ITERATIONS; i++)
+    block_read (block, i % sectors, buffer);
+  bench_report ("ide-read-seq", IDE_ITERATIONS, timer_ns () - start);
+
+  start = timer_ns ();
+  for (i = 0; i < IDE_ITERATIONS; i++)
+    block_read (block, random_ulong () % sectors, buffer);
+  bench_report ("ide-read-random", IDE_ITERATIONS, timer_ns () - start);
+}
+#endif /* FILESYS */
@@ -0,0 +1,108 @@
+/* Benchmarks for thread switching and synchronization
+   primitives. */
+
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SWITCH_ITERATIONS 10000
+#define LOCK_ITERATIONS 100000
+
+/* Set to end the partner thread in bench_ctxsw(). */
+static volatile bool yield_done;
+
+/* Signaled by partner threads when they exit. */
+static struct semaphore partner_exited;
+
+static void
+yield_partner (void *aux UNUSED)
+{
+  while (!yield_done)
+    thread_yield ();
+  sema_up (&partner_exited);
+}
+
+/* Measures the cost of a thread switch by yielding back and
+   forth between two threads of equal priority.  Every yield in
+   the loop below causes two switches: to the partner and back. */
+void
+bench_ctxsw (void)
+{
+  int64_t start;
+  int i;
+
+  yield_done = false;
+  sema_init (&partner_exited, 0);
+  thread_create ("yield", thread_get_priority (), yield_partner, NULL);
+  thread_yield ();
+
+  start = timer_ns ();
+  for (i = 0; i < SWITCH_ITERATIONS; i++)
+    thread_yield ();
+  bench_report ("ctxsw-yield", SWITCH_ITERATIONS * 2, timer_ns () - start);
+
+  yield_done = true;
+  sema_down (&partner_exited);
+}
+
+/* Semaphores for bench_sema(). */
+static struct semaphore ping, pong;
+
+static void
+pong_partner (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < SWITCH_ITERATIONS; i++)
+    {
+      sema_down (&ping);
+      sema_up (&pong);
+    }
+  sema_up (&partner_exited);
+}
+
+/* Measures a semaphore round trip between two threads: each
+   iteration wakes the partner and blocks until it answers. */
+void
+bench_sema (void)
+{
+  int64_t start;
+  int i;
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  sema_init (&partner_exited, 0);
+  thread_create ("pong", thread_get_priority (), pong_partner, NULL);
+
+  start = timer_ns ();
+  for (i = 0; i < SWITCH_ITERATIONS; i++)
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+    }
+  bench_report ("sema-pingpong", SWITCH_ITERATIONS, timer_ns () - start);
+
+  sema_down (&partner_exited);
+}
+
+/* Measures an uncontended lock_acquire() and lock_release()
+   pair. */
+void
+bench_lock (void)
+{
+  struct lock lock;
+  int64_t start;
+  int i;
+
+  lock_init (&lock);
+  start = timer_ns ();
+  for (i = 0; i < LOCK_ITERATIONS; i++)
+    {
+      lock_acquire (&lock);
+      lock_release (&lock);
+    }
+  bench_report ("lock-acquire-release", LOCK_ITERATIONS,
+                timer_ns () - start);
+}
@@ -0,0 +1,51 @@
+/* Tests the blockstat syscall: every block device's statistics
+   can be read, at least one device has been read from to load
+   this program, and each disk's histograms account for every
+   request, while partitions, whose requests their disk times,
+   have none. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Returns the sum of the buckets in HIST. */
+static uint64_t
+histogram_sum (const uint32_t hist[BLOCKSTAT_BUCKETS])
+{
+  uint64_t sum = 0;
+  int i;
+
+  for (i = 0; i < BLOCKSTAT_BUCKETS; i++)
+    sum += hist[i];
+  return sum;
+}
+
+void
+test_main (void)
+{
+  struct blockstat st;
+  bool any_reads = false;
+  bool consistent = true;
+  int cnt;
+
+  for (cnt = 0; blockstat (cnt, &st); cnt++)
+    {
+      uint64_t requests = st.read_cnt + st.write_cnt;
+
+      if (st.read_cnt > 0)
+        any_reads = true;
+      if (st.read_bytes != st.read_cnt * 512
+          || st.write_bytes != st.write_cnt * 512)
+        consistent = false;
+      else if (st.type == BLOCKSTAT_DISK
+               ? (histogram_sum (st.service) < requests
+                  || histogram_sum (st.seek) < requests)
+               : (histogram_sum (st.service) != 0
+                  || histogram_sum (st.seek) != 0))
+        consistent = false;
+    }
+  CHECK (cnt > 0, "blockstat found devices");
+  CHECK (any_reads, "some device has been read");
+  CHECK (consistent, "histograms account for every request");
+  CHECK (!blockstat (-1, &st), "blockstat (-1) fails");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(blockstat) begin
+(blockstat) blockstat found devices
+(blockstat) some device has been read
+(blockstat) histograms account for every request
+(blockstat) blockstat (-1) fails
+(blockstat) end
+blockstat: exit(0)
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Child process run by stride-fair.
+   Sets its ticket count to argv[1], busy-waits until the
+   millisecond timestamp in argv[2], then counts loop iterations
+   until the timestamp in argv[3].  Returns the count in
+   thousands. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-spin";
+
+/* Returns the current time in milliseconds. */
+static int
+now_ms (void)
+{
+  return nanotime () / 1000000;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int start, end;
+  int count = 0;
+
+  if (argc != 4)
+    fail ("usage: child-spin TICKETS START END");
+  if (settickets (atoi (argv[1])) != 0)
+    fail ("settickets (%s) failed", argv[1]);
+  start = atoi (argv[2]);
+  end = atoi (argv[3]);
+
+  while (now_ms () < start)
+    continue;
+  while (now_ms () < end)
+    {
+      volatile int i;
+      for (i = 0; i < 1000; i++)
+        continue;
+      count++;
+    }
+  return count;
+}
@@ -0,0 +1,32 @@
+/* Tests the nanotime syscall: the clock is running, never goes
+   backward, and advances across a busy loop. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  volatile int i;
+  int64_t t0, t1, prev;
+  bool monotonic = true;
+
+  t0 = nanotime ();
+  CHECK (t0 > 0, "nanotime () is positive");
+
+  prev = t0;
+  for (i = 0; i < 1000; i++)
+    {
+      int64_t now = nanotime ();
+      if (now < prev)
+        monotonic = false;
+      prev = now;
+    }
+  CHECK (monotonic, "nanotime () never goes backward");
+
+  for (i = 0; i < 1000000; i++)
+    continue;
+  t1 = nanotime ();
+  CHECK (t1 > t0, "nanotime () advances");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(nanotime) begin
+(nanotime) nanotime () is positive
+(nanotime) nanotime () never goes backward
+(nanotime) nanotime () advances
+(nanotime) end
+nanotime: exit(0)
+EOF
+pass;
@@ -0,0 +1,20 @@
+/* Tests the profile syscall: the profiler can be started once,
+   collects samples while a busy loop runs, and can be stopped
+   once. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  volatile int i;
+
+  CHECK (profile (true) == 0, "profile (true)");
+  CHECK (profile (true) == -1, "profile (true) again fails");
+  for (i = 0; i < 10000000; i++)
+    continue;
+  CHECK (profile (false) >= 0, "profile (false)");
+  CHECK (profile (false) == -1, "profile (false) again fails");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+fail "missing profiler dump\n"
+  if !grep (/^profile: begin \d+ \d+$/, @output)
+     || !grep (/^profile: end$/, @output);
+@output = grep (!/^profile: (begin |end$|\d+ [ku] )/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(profile) begin
+(profile) profile (true)
+(profile) profile (true) again fails
+(profile) profile (false)
+(profile) profile (false) again fails
+(profile) end
+profile: exit(0)
+EOF
+pass;
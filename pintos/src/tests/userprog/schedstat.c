@@ -0,0 +1,21 @@
+/* Tests the schedstat syscall, which must report system-wide
+   totals and refuse processes that no longer exist. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct schedstat st;
+  pid_t child;
+
+  child = exec ("child-simple");
+  CHECK (wait (child) == 81, "wait (exec (\"child-simple\"))");
+
+  CHECK (schedstat (SCHEDSTAT_ALL, &st), "schedstat (SCHEDSTAT_ALL)");
+  CHECK (st.voluntary > 0, "voluntary switches counted");
+  CHECK (st.wakeups > 0, "wakeups counted");
+  CHECK (!schedstat (child, &st), "schedstat (exited child) fails");
+}
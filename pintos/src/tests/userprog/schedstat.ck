@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(schedstat) begin
+(child-simple) run
+child-simple: exit(81)
+(schedstat) wait (exec ("child-simple"))
+(schedstat) schedstat (SCHEDSTAT_ALL)
+(schedstat) voluntary switches counted
+(schedstat) wakeups counted
+(schedstat) schedstat (exited child) fails
+(schedstat) end
+schedstat: exit(0)
+EOF
+pass;
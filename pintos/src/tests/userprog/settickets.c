@@ -0,0 +1,16 @@
+/* Tests the settickets syscall, which must accept ticket counts
+   in range and reject the rest. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  CHECK (settickets (0) == -1, "settickets(0) rejected");
+  CHECK (settickets (-1) == -1, "settickets(-1) rejected");
+  CHECK (settickets (1000000) == -1, "settickets(1000000) rejected");
+  CHECK (settickets (1) == 0, "settickets(1)");
+  CHECK (settickets (500) == 0, "settickets(500)");
+}
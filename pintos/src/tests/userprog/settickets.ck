@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(settickets) begin
+(settickets) settickets(0) rejected
+(settickets) settickets(-1) rejected
+(settickets) settickets(1000000) rejected
+(settickets) settickets(1)
+(settickets) settickets(500)
+(settickets) end
+settickets: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Runs two CPU-bound children holding 300 and 100 tickets under
+   the stride scheduler, over the same interval, and checks that
+   the work they get done is in proportion to their tickets,
+   within 25%. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Milliseconds allowed for both children to load before they
+   start counting, and how long they count for. */
+#define START_DELAY 500
+#define DURATION 2000
+
+void
+test_main (void)
+{
+  char cmd[64];
+  pid_t high, low;
+  int start, high_cnt, low_cnt;
+
+  start = nanotime () / 1000000 + START_DELAY;
+
+  snprintf (cmd, sizeof cmd, "child-spin 300 %d %d",
+            start, start + DURATION);
+  CHECK ((high = exec (cmd)) > 0, "exec child with 300 tickets");
+  snprintf (cmd, sizeof cmd, "child-spin 100 %d %d",
+            start, start + DURATION);
+  CHECK ((low = exec (cmd)) > 0, "exec child with 100 tickets");
+
+  high_cnt = wait (high);
+  low_cnt = wait (low);
+  CHECK (high_cnt > 0 && low_cnt > 0, "both children made progress");
+  if (4 * high_cnt < 9 * low_cnt || 4 * high_cnt > 15 * low_cnt)
+    fail ("children did %d and %d units of work, not 3:1",
+          high_cnt, low_cnt);
+  msg ("work is in proportion to tickets");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(stride-fair) begin
+(stride-fair) exec child with 300 tickets
+(stride-fair) exec child with 100 tickets
+(stride-fair) both children made progress
+(stride-fair) work is in proportion to tickets
+(stride-fair) end
+EOF
+pass;
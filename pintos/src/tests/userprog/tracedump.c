@@ -0,0 +1,25 @@
+/* Tests the tracedump syscall with syscall tracing enabled: the
+   trace file must hold a header and at least the events for the
+   system calls made before the dump. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  unsigned char magic[4];
+  int handle;
+  int cnt;
+
+  cnt = tracedump ("trace");
+  CHECK (cnt > 0, "tracedump (\"trace\")");
+  CHECK ((handle = open ("trace")) > 1, "open \"trace\"");
+  CHECK (filesize (handle) == 56 + cnt * 20, "trace file size matches");
+  CHECK (read (handle, magic, sizeof magic) == sizeof magic,
+         "read trace header");
+  CHECK (magic[0] == 'P' && magic[1] == 'T' && magic[2] == 'R'
+         && magic[3] == 'C', "trace header magic");
+  close (handle);
+}
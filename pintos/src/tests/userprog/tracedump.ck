@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^trace: /, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(tracedump) begin
+(tracedump) tracedump ("trace")
+(tracedump) open "trace"
+(tracedump) trace file size matches
+(tracedump) read trace header
+(tracedump) trace header magic
+(tracedump) end
+tracedump: exit(0)
+EOF
+pass;
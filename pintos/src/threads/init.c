@@ -20,8 +20,13 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "tests/bench/bench.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -37,6 +42,13 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "vm/zram.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -105,18 +117,24 @@ main (void)
   gdt_init ();
 #endif
 
-  /* Initialize interrupt handlers. */
+  /* Initialize interrupt handlers, and the workqueues that they
+     defer work to. */
+  workqueue_init ();
   intr_init ();
   timer_init ();
+  profile_init ();
+  trace_init ();
   kbd_init ();
   input_init ();
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_start ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -126,6 +144,12 @@ main (void)
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
+#ifdef VM
+  frame_init ();
+  share_init ();
+  swap_init ();
+  zram_init ();
+#endif
 
   printf ("Boot complete.\n");
   
@@ -256,9 +280,23 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-stride"))
+        thread_stride = true;
+      else if (!strcmp (name, "-profile"))
+        profile_at_boot = true;
+      else if (!strcmp (name, "-irqsoff"))
+        intr_irqsoff = true;
+      else if (!strcmp (name, "-trace"))
+        trace_configure (value);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-stack"))
+        page_stack_limit = atoi (value);
+      else if (!strcmp (name, "-zram"))
+        zram_pages = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -277,17 +315,21 @@ parse_options (char **argv)
   return argv;
 }
 
-/* Runs the task specified in ARGV[1]. */
+/* Runs the task specified in ARGV[1].  Tasks named "bench-*"
+   are kernel microbenchmarks from tests/bench. */
 static void
 run_task (char **argv)
 {
   const char *task = argv[1];
   
   printf ("Executing '%s':\n", task);
+  if (strstr (task, "bench-") == task)
+    run_bench (task);
+  else
 #ifdef USERPROG
-  process_wait (process_execute (task));
+    process_wait (process_execute (task));
 #else
-  run_test (task);
+    run_test (task);
 #endif
   printf ("Execution of '%s' complete.\n", task);
 }
@@ -313,6 +355,7 @@ run_actions (char **argv)
       {"ls", 1, fsutil_ls},
       {"cat", 2, fsutil_cat},
       {"rm", 2, fsutil_rm},
+      {"frag", 1, fsutil_frag},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
 #endif
@@ -357,10 +400,12 @@ usage (void)
 #else
           "  run TEST           Run TEST.\n"
 #endif
+          "  run bench-NAME     Run kernel benchmark NAME, or all with bench-all.\n"
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
           "  rm FILE            Delete FILE.\n"
+          "  frag               Report file system fragmentation.\n"
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
@@ -379,8 +424,18 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -stride            Use proportional-share stride scheduler.\n"
+          "  -profile           Sample the CPU from boot until power off.\n"
+          "  -irqsoff           Report longest intervals with interrupts off.\n"
+          "  -trace=CAT,...     Trace events in categories CAT: cache, ide,\n"
+          "                     syscall, sched, lock, block, or all.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -stack=COUNT       Limit each process's stack to COUNT pages.\n"
+          "  -zram=COUNT        Compress evicted pages into COUNT kernel pages\n"
+          "                     (default 64, 0 to disable).\n"
 #endif
           );
   shutdown_power_off ();
@@ -37,6 +37,53 @@ static const char *intr_names[INTR_CNT];
    unexpected interrupt is one that has no registered handler. */
 static unsigned int unexpected_cnt[INTR_CNT];
 
+/* Handler statistics for one interrupt vector.  Times are in
+   time stamp counter cycles and include any nested interrupts.
+   Handlers for internal interrupts may sleep, so for them this
+   is elapsed time, not time spent running. */
+struct intr_stats
+  {
+    unsigned int cnt;           /* Number of interrupts handled. */
+    uint64_t cycles;            /* Total time in the handler. */
+    uint64_t max_cycles;        /* Longest time in the handler. */
+  };
+static struct intr_stats intr_stats[INTR_CNT];
+
+/* Irqs-off tracer.
+
+   While intr_irqsoff is true, each interval during which
+   interrupts are disabled is timed, from the intr_disable() or
+   interrupt gate that turns them off to the intr_enable() or
+   interrupt return that turns them back on.  The IRQSOFF_TOP
+   longest intervals are kept, with the code addresses at both
+   ends, for intr_print_stats() to report.  A context switch
+   with interrupts off does not end an interval, so an interval
+   may begin in one thread and end in another. */
+#define IRQSOFF_TOP 8
+
+/* One irqs-off interval. */
+struct irqsoff_interval
+  {
+    uint64_t cycles;            /* Length of the interval. */
+    void *off_site;             /* Where interrupts were disabled. */
+    void *on_site;              /* Where they were enabled again. */
+  };
+
+/* If true, trace irqs-off intervals.
+   Controlled by kernel command-line option "-irqsoff". */
+bool intr_irqsoff;
+
+static struct irqsoff_interval irqsoff_top[IRQSOFF_TOP]; /* Longest first. */
+static unsigned int irqsoff_cnt;        /* Number of intervals timed. */
+static uint64_t irqsoff_cycles;         /* Total length of intervals. */
+static uint64_t irqsoff_start;          /* Start of current interval, or 0. */
+static void *irqsoff_site;              /* Where current interval began. */
+
+static enum intr_level enable (void *site);
+static enum intr_level disable (void *site);
+static void irqsoff_begin (void *site);
+static void irqsoff_end (void *site);
+
 /* External interrupts are those generated by devices outside the
    CPU, such as the timer.  External interrupts run with
    interrupts turned off, so they never nest, nor are they ever
@@ -80,16 +127,35 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  void *site = __builtin_return_address (0);
+  return level == INTR_ON ? enable (site) : disable (site);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) 
+{
+  return enable (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) 
+{
+  return disable (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of the caller at SITE and returns
+   the previous interrupt status. */
+static enum intr_level
+enable (void *site) 
 {
   enum intr_level old_level = intr_get_level ();
   ASSERT (!intr_context ());
 
+  if (intr_irqsoff && old_level == INTR_OFF)
+    irqsoff_end (site);
+
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -99,9 +165,10 @@ intr_enable (void)
   return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void) 
+/* Disables interrupts on behalf of the caller at SITE and
+   returns the previous interrupt status. */
+static enum intr_level
+disable (void *site) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,9 +177,12 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (intr_irqsoff && old_level == INTR_ON)
+    irqsoff_begin (site);
+
   return old_level;
 }
-
+
 /* Initializes the interrupt system. */
 void
 intr_init (void)
@@ -346,6 +416,9 @@ intr_handler (struct intr_frame *frame)
 {
   bool external;
   intr_handler_func *handler;
+  struct intr_stats *stats;
+  enum intr_level old_level;
+  uint64_t start, cycles;
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
@@ -361,8 +434,15 @@ intr_handler (struct intr_frame *frame)
       yield_on_return = false;
     }
 
-  /* Invoke the interrupt's handler. */
+  /* An interrupt gate turns interrupts off on entry, which starts
+     an irqs-off interval if they were on before. */
   handler = intr_handlers[frame->vec_no];
+  if (intr_irqsoff && (frame->eflags & FLAG_IF)
+      && intr_get_level () == INTR_OFF)
+    irqsoff_begin (handler);
+
+  /* Invoke the interrupt's handler. */
+  start = timer_cycles ();
   if (handler != NULL)
     handler (frame);
   else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
@@ -373,6 +453,18 @@ intr_handler (struct intr_frame *frame)
     }
   else
     unexpected_interrupt (frame);
+  cycles = timer_cycles () - start;
+
+  /* Account for the time spent in the handler.  Handlers for
+     internal interrupts may run with interrupts on, so turn them
+     off to keep the update atomic. */
+  stats = &intr_stats[frame->vec_no];
+  old_level = intr_disable ();
+  stats->cnt++;
+  stats->cycles += cycles;
+  if (cycles > stats->max_cycles)
+    stats->max_cycles = cycles;
+  intr_set_level (old_level);
 
   /* Complete the processing of an external interrupt. */
   if (external) 
@@ -386,6 +478,12 @@ intr_handler (struct intr_frame *frame)
       if (yield_on_return) 
         thread_yield (); 
     }
+
+  /* Returning from the interrupt will turn interrupts back on if
+     they were on when it occurred. */
+  if (intr_irqsoff && (frame->eflags & FLAG_IF)
+      && intr_get_level () == INTR_OFF)
+    irqsoff_end (handler);
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -430,6 +528,74 @@ intr_dump_frame (const struct intr_frame *f)
           f->cs, f->ds, f->es, f->ss);
 }
 
+/* Starts an irqs-off interval, because the code at SITE turned
+   interrupts off. */
+static void
+irqsoff_begin (void *site) 
+{
+  irqsoff_start = timer_cycles ();
+  irqsoff_site = site;
+}
+
+/* Ends the current irqs-off interval, if any, because the code
+   at SITE is about to turn interrupts on, and records it if it
+   is among the longest so far.  Interrupts must be off. */
+static void
+irqsoff_end (void *site) 
+{
+  uint64_t cycles;
+  int i;
+
+  if (irqsoff_start == 0)
+    return;
+  cycles = timer_cycles () - irqsoff_start;
+  irqsoff_start = 0;
+  irqsoff_cnt++;
+  irqsoff_cycles += cycles;
+
+  /* Insertion sort into irqsoff_top, longest first. */
+  for (i = IRQSOFF_TOP; i > 0 && irqsoff_top[i - 1].cycles < cycles; i--)
+    if (i < IRQSOFF_TOP)
+      irqsoff_top[i] = irqsoff_top[i - 1];
+  if (i < IRQSOFF_TOP)
+    {
+      irqsoff_top[i].cycles = cycles;
+      irqsoff_top[i].off_site = irqsoff_site;
+      irqsoff_top[i].on_site = site;
+    }
+}
+
+/* Prints interrupt handler statistics for each vector that has
+   seen an interrupt, and the longest irqs-off intervals if
+   irqs-off tracing is enabled.  The code addresses can be
+   turned into function names with the "backtrace" utility. */
+void
+intr_print_stats (void) 
+{
+  int i;
+
+  for (i = 0; i < INTR_CNT; i++)
+    {
+      const struct intr_stats *s = &intr_stats[i];
+      if (s->cnt > 0)
+        printf ("Interrupt %#04x (%s): %u handled, "
+                "avg %lld ns, max %lld ns\n",
+                i, intr_names[i], s->cnt,
+                timer_cycles_to_ns (s->cycles / s->cnt),
+                timer_cycles_to_ns (s->max_cycles));
+    }
+
+  if (intr_irqsoff && irqsoff_cnt > 0)
+    {
+      printf ("Irqsoff: %u intervals, avg %lld ns\n", irqsoff_cnt,
+              timer_cycles_to_ns (irqsoff_cycles / irqsoff_cnt));
+      for (i = 0; i < IRQSOFF_TOP && irqsoff_top[i].cycles > 0; i++)
+        printf ("Irqsoff: %lld ns, off at %p, on at %p\n",
+                timer_cycles_to_ns (irqsoff_top[i].cycles),
+                irqsoff_top[i].off_site, irqsoff_top[i].on_site);
+    }
+}
+
 /* Returns the name of interrupt VEC. */
 const char *
 intr_name (uint8_t vec) 
@@ -1,12 +1,13 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,22 +24,73 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
 
-/* A memory pool. */
+   Each pool is managed as a binary buddy system.  Free memory is
+   kept as blocks of 2**ORDER pages, each aligned to its size
+   relative to the pool's base, on one free list per order.  An
+   allocation takes a block of the smallest sufficient order,
+   splitting a larger one if necessary, and returns the pages it
+   does not need to the free lists.  Freeing a block merges it
+   with its buddy, the other half of the block of the next order
+   up, for as long as the buddy is also free.  Both take time
+   proportional to the number of orders, not to the size of the
+   pool, and freed memory always recombines into the largest
+   blocks that it can.  That keeps the critical sections short
+   enough to protect each pool by disabling interrupts, which
+   also lets the scheduler free a dead thread's page with
+   interrupts off.
+
+   Each pool also keeps a short list of free pages that the idle
+   thread has already zeroed, through palloc_prezero(), so that
+   single-page PAL_ZERO allocations need not zero a page while
+   the caller waits.  Those pages are allocated as far as the
+   buddy system is concerned while they are on the list, and are
+   freed again if the pool otherwise runs out. */
+
+/* Maximum number of pre-zeroed pages per pool. */
+#define PREZERO_MAX 32
+
+/* Largest block order: 2**20 pages is more than any pool. */
+#define MAX_ORDER 20
+
+/* States of a page in a pool's page_state array. */
+#define PAGE_FREE_HEAD 0x80     /* First page of a free block; the
+                                   low bits are the block's order. */
+#define PAGE_USED 0x40          /* Allocated. */
+                                /* 0: Free, not first in its block. */
+
+/* A memory pool.  Protected by disabling interrupts. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *page_state;                /* State of each page. */
+    struct list free_lists[MAX_ORDER + 1]; /* Free blocks by order. */
+    size_t page_cnt;                    /* Number of pages. */
+    size_t free_cnt;                    /* Number of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    void *zeroed[PREZERO_MAX];          /* Zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of zeroed pages. */
+    unsigned zeroed_hits;               /* PAL_ZERO served from ZEROED. */
+    unsigned zeroed_misses;             /* PAL_ZERO zeroed by caller. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Called when the kernel pool runs out, or null. */
+static palloc_reclaim_func *kernel_reclaim;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void *take_zeroed (struct pool *);
+static bool reclaim_zeroed (struct pool *);
+static bool prezero_pool (struct pool *);
+
+/* Returned by alloc_pages() on failure. */
+#define ALLOC_ERROR SIZE_MAX
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -61,6 +113,18 @@ palloc_init (size_t user_page_limit)
              user_pages, "user pool");
 }
 
+/* Registers RECLAIM to be called, outside the pool's critical
+   section, when the kernel pool cannot satisfy an allocation.
+   It should free any kernel pages that its subsystem holds only
+   as a cache.  The allocation is retried if it frees any.  Only
+   one function may be registered. */
+void
+palloc_register_reclaim (palloc_reclaim_func *reclaim)
+{
+  ASSERT (kernel_reclaim == NULL);
+  kernel_reclaim = reclaim;
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -71,17 +135,37 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void *pages;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  if (page_cnt == 1 && (flags & PAL_ZERO))
+    {
+      pages = take_zeroed (pool);
+      if (pages != NULL)
+        return pages;
+    }
+
+  old_level = intr_disable ();
+  page_idx = alloc_pages (pool, page_cnt);
+  if (page_idx == ALLOC_ERROR && reclaim_zeroed (pool))
+    page_idx = alloc_pages (pool, page_cnt);
+  intr_set_level (old_level);
+
+  /* The kernel pool may be short only because pages are held in
+     a cache elsewhere in the kernel. */
+  if (page_idx == ALLOC_ERROR && pool == &kernel_pool
+      && kernel_reclaim != NULL && kernel_reclaim () > 0)
+    {
+      old_level = intr_disable ();
+      page_idx = alloc_pages (pool, page_cnt);
+      intr_set_level (old_level);
+    }
 
-  if (page_idx != BITMAP_ERROR)
+  if (page_idx != ALLOC_ERROR)
     pages = pool->base + PGSIZE * page_idx;
   else
     pages = NULL;
@@ -118,6 +202,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -137,8 +222,9 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  free_pages (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +234,237 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes a free page ahead of time for a later PAL_ZERO
+   allocation, if any pool is short of zeroed pages and has a free
+   page.  Never blocks, so that the idle thread may call it, and
+   only touches a pool with interrupts off, so that the idle
+   thread cannot be preempted halfway through an update.  The
+   page itself is zeroed with interrupts on.  Returns true if a page was zeroed, false if there was nothing
+   to do.  Must be called with interrupts on. */
+bool
+palloc_prezero (void)
+{
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_ON);
+
+  return prezero_pool (&kernel_pool) || prezero_pool (&user_pool);
+}
+
+/* Prints statistics about pre-zeroed pages and free memory. */
+void
+palloc_print_stats (void)
+{
+  printf ("Palloc: kernel %u/%u and user %u/%u PAL_ZERO pages pre-zeroed\n",
+          kernel_pool.zeroed_hits,
+          kernel_pool.zeroed_hits + kernel_pool.zeroed_misses,
+          user_pool.zeroed_hits,
+          user_pool.zeroed_hits + user_pool.zeroed_misses);
+  printf ("Palloc: %zu of %zu kernel and %zu of %zu user pages free\n",
+          kernel_pool.free_cnt, kernel_pool.page_cnt,
+          user_pool.free_cnt, user_pool.page_cnt);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's page_state array at its base.
+     Calculate the space needed for the array
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t state_pages = DIV_ROUND_UP (page_cnt, PGSIZE);
+  int order;
+
+  if (state_pages > page_cnt)
+    PANIC ("Not enough memory in %s for page states.", name);
+  page_cnt -= state_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
-  /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  /* Initialize the pool, with every page allocated, and then
+     free them all to build the free lists. */
+  p->page_state = base;
+  memset (p->page_state, PAGE_USED, page_cnt);
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free_lists[order]);
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  p->base = base + state_pages * PGSIZE;
+  p->zeroed_cnt = 0;
+  free_pages (p, 0, page_cnt);
+}
+
+/* Returns the free list element stored in the first page of
+   POOL's block at PAGE_IDX. */
+static inline struct list_elem *
+block_elem (struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Adds POOL's block of 2**ORDER pages at PAGE_IDX, which must
+   not have a free buddy, to its free list. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order)
+{
+  pool->page_state[page_idx] = PAGE_FREE_HEAD | order;
+  list_push_front (&pool->free_lists[order], block_elem (pool, page_idx));
+}
+
+/* Removes POOL's free block at PAGE_IDX from its free list. */
+static void
+pop_block (struct pool *pool, size_t page_idx)
+{
+  pool->page_state[page_idx] = 0;
+  list_remove (block_elem (pool, page_idx));
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or ALLOC_ERROR if no block is large
+   enough.  Interrupts must be off. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt)
+{
+  size_t page_idx;
+  int order, want;
+
+  /* Find the smallest free block that is large enough. */
+  for (want = 0; want <= MAX_ORDER && ((size_t) 1 << want) < page_cnt;
+       want++)
+    continue;
+  for (order = want; order <= MAX_ORDER; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      break;
+  if (order > MAX_ORDER)
+    return ALLOC_ERROR;
+
+  page_idx = pg_no (list_front (&pool->free_lists[order]))
+             - pg_no (pool->base);
+  pop_block (pool, page_idx);
+
+  /* Split it, returning the upper halves to the free lists. */
+  while (order > want)
+    {
+      order--;
+      push_block (pool, page_idx + ((size_t) 1 << order), order);
+    }
+
+  memset (pool->page_state + page_idx, PAGE_USED, (size_t) 1 << want);
+  pool->free_cnt -= (size_t) 1 << want;
+
+  /* Give back the pages past PAGE_CNT. */
+  free_pages (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT allocated pages of POOL, starting at
+   PAGE_IDX.  Interrupts must be off. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  ASSERT (page_idx + page_cnt <= pool->page_cnt);
+
+  while (page_cnt > 0)
+    {
+      /* Free the largest aligned block that starts at PAGE_IDX
+         and fits in the range, merging it with free buddies. */
+      int order = 0;
+      size_t head = page_idx;
+      size_t block_cnt, i;
+
+      while (order < MAX_ORDER
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      block_cnt = (size_t) 1 << order;
+      for (i = 0; i < block_cnt; i++)
+        {
+          ASSERT (pool->page_state[page_idx + i] == PAGE_USED);
+          pool->page_state[page_idx + i] = 0;
+        }
+      pool->free_cnt += block_cnt;
+      page_idx += block_cnt;
+      page_cnt -= block_cnt;
+
+      for (; order < MAX_ORDER; order++)
+        {
+          size_t buddy = head ^ ((size_t) 1 << order);
+          if (buddy + ((size_t) 1 << order) > pool->page_cnt
+              || pool->page_state[buddy] != (PAGE_FREE_HEAD | order))
+            break;
+          pop_block (pool, buddy);
+          if (buddy < head)
+            head = buddy;
+        }
+      push_block (pool, head, order);
+    }
+}
+
+/* Takes a pre-zeroed page from POOL and returns it, or returns a
+   null pointer if there is none. */
+static void *
+take_zeroed (struct pool *pool)
+{
+  enum intr_level old_level;
+  void *page = NULL;
+
+  old_level = intr_disable ();
+  if (pool->zeroed_cnt > 0)
+    {
+      page = pool->zeroed[--pool->zeroed_cnt];
+      pool->zeroed_hits++;
+    }
+  else
+    pool->zeroed_misses++;
+  intr_set_level (old_level);
+  return page;
+}
+
+/* Frees all of POOL's pre-zeroed pages, so that they can satisfy
+   any allocation.  Interrupts must be off.  Returns true if
+   there were any such pages. */
+static bool
+reclaim_zeroed (struct pool *pool)
+{
+  bool reclaimed = pool->zeroed_cnt > 0;
+
+  while (pool->zeroed_cnt > 0)
+    {
+      void *page = pool->zeroed[--pool->zeroed_cnt];
+      free_pages (pool, pg_no (page) - pg_no (pool->base), 1);
+    }
+  return reclaimed;
+}
+
+/* Zeroes a free page of POOL and adds it to the pool's zeroed
+   pages, if it has room for more.  Returns true if successful,
+   false if there is no room or no free page. */
+static bool
+prezero_pool (struct pool *pool)
+{
+  enum intr_level old_level;
+  size_t page_idx = ALLOC_ERROR;
+  uint8_t *page;
+
+  old_level = intr_disable ();
+  if (pool->zeroed_cnt < PREZERO_MAX)
+    page_idx = alloc_pages (pool, 1);
+  intr_set_level (old_level);
+  if (page_idx == ALLOC_ERROR)
+    return false;
+
+  /* Zero the page with interrupts on.  The page is allocated as
+     far as the buddy system is concerned, so no other thread
+     touches it meanwhile. */
+  page = pool->base + PGSIZE * page_idx;
+  memset (page, 0, PGSIZE);
+
+  /* Only the idle thread adds pages, so there is still room. */
+  old_level = intr_disable ();
+  ASSERT (pool->zeroed_cnt < PREZERO_MAX);
+  pool->zeroed[pool->zeroed_cnt++] = page;
+  intr_set_level (old_level);
+  return true;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +474,7 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,17 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* Function that frees pages the kernel pool is short of,
+   returning the number freed.  See palloc_register_reclaim(). */
+typedef size_t palloc_reclaim_func (void);
+
 void palloc_init (size_t user_page_limit);
+void palloc_register_reclaim (palloc_reclaim_func *);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_prezero (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
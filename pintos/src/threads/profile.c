@@ -0,0 +1,212 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/serial.h"
+
+/* Sampling CPU profiler.
+
+   While the profiler runs, every timer interrupt records the
+   interrupted instruction pointer, whether it was in user or
+   kernel mode, the running thread's tid, and, for kernel
+   samples, the return addresses found by following saved frame
+   pointers up the interrupted thread's stack.  Samples go into a
+   ring buffer that is allocated when profiling starts, so that
+   the profiler costs no memory when it is off; once the buffer
+   is full, the oldest samples are overwritten.
+
+   Stopping the profiler writes the samples to the serial port,
+   one per line, as
+
+        profile: begin SAMPLES OVERWRITTEN
+        profile: TID k|u EIP [RETURN-ADDRESS...]
+        profile: end
+
+   with addresses in hex.  utils/pintos-prof turns this into a
+   per-function profile or into folded stacks for flame
+   graphs. */
+
+/* Pages in the sample buffer. */
+#define PROFILE_PAGES 16
+
+/* Return addresses recorded per kernel sample. */
+#define PROFILE_DEPTH 6
+
+/* One sample. */
+struct sample
+  {
+    uint32_t eip;                       /* Interrupted instruction. */
+    tid_t tid;                          /* Running thread. */
+    uint8_t user;                       /* Interrupted user code? */
+    uint8_t depth;                      /* Entries used in STACK. */
+    uint32_t stack[PROFILE_DEPTH];      /* Return addresses, innermost first. */
+  };
+
+/* Start profiling at boot? */
+bool profile_at_boot;
+
+/* Sample buffer, or a null pointer if the profiler is off.
+   Accessed by the timer interrupt handler, so interrupts must be
+   off to change it. */
+static struct sample *samples;
+static size_t sample_max;               /* Capacity of SAMPLES. */
+static uint64_t sample_cnt;             /* Samples taken so far. */
+
+static size_t stack_walk (uint32_t ebp, uint32_t *stack);
+static void profile_dump (struct sample *, size_t max, uint64_t cnt);
+static void serial_puts (const char *);
+
+/* Starts the profiler if it was requested on the kernel command
+   line.  Must be called after the page allocator is
+   initialized. */
+void
+profile_init (void)
+{
+  if (profile_at_boot && !profile_start ())
+    printf ("profile: not enough memory for sample buffer\n");
+}
+
+/* Starts profiling, discarding any earlier samples.  Returns
+   true if successful, false if the profiler is already running
+   or the sample buffer cannot be allocated. */
+bool
+profile_start (void)
+{
+  struct sample *buf;
+  enum intr_level old_level;
+  bool success = false;
+
+  buf = palloc_get_multiple (0, PROFILE_PAGES);
+  if (buf == NULL)
+    return false;
+
+  old_level = intr_disable ();
+  if (samples == NULL)
+    {
+      sample_max = PROFILE_PAGES * PGSIZE / sizeof *samples;
+      sample_cnt = 0;
+      samples = buf;
+      success = true;
+    }
+  intr_set_level (old_level);
+
+  if (!success)
+    palloc_free_multiple (buf, PROFILE_PAGES);
+  return success;
+}
+
+/* Stops profiling and writes the samples to the serial port.
+   Returns the number of samples written, or -1 if the profiler
+   was not running. */
+int
+profile_stop (void)
+{
+  struct sample *buf;
+  enum intr_level old_level;
+  size_t max;
+  uint64_t cnt;
+
+  old_level = intr_disable ();
+  buf = samples;
+  max = sample_max;
+  cnt = sample_cnt;
+  samples = NULL;
+  intr_set_level (old_level);
+
+  if (buf == NULL)
+    return -1;
+  profile_dump (buf, max, cnt);
+  palloc_free_multiple (buf, PROFILE_PAGES);
+  return cnt < max ? cnt : max;
+}
+
+/* Records a sample for the interrupted context described by F.
+   Called by the timer interrupt handler. */
+void
+profile_sample (const struct intr_frame *f)
+{
+  struct sample *s;
+
+  ASSERT (intr_context ());
+
+  if (samples == NULL)
+    return;
+
+  s = &samples[sample_cnt++ % sample_max];
+  s->eip = (uint32_t) f->eip;
+  s->tid = thread_current ()->tid;
+  s->user = (f->cs & 3) == 3;
+  s->depth = s->user ? 0 : stack_walk (f->ebp, s->stack);
+}
+
+/* Follows the chain of saved frame pointers starting at EBP,
+   storing up to PROFILE_DEPTH return addresses into STACK, and
+   returns the number stored.  Code compiled without frame
+   pointers leaves other values in EBP, so the walk stops as soon
+   as a frame pointer leaves the running thread's stack or fails
+   to move toward its base. */
+static size_t
+stack_walk (uint32_t ebp, uint32_t *stack)
+{
+  uintptr_t base = (uintptr_t) pg_round_down (thread_current ());
+  uintptr_t top = base + PGSIZE;
+  size_t depth = 0;
+
+  while (depth < PROFILE_DEPTH
+         && ebp > base && ebp + 2 * sizeof (uint32_t) <= top
+         && ebp % sizeof (uint32_t) == 0)
+    {
+      uint32_t *frame = (uint32_t *) ebp;
+      if (frame[1] == 0)
+        break;
+      stack[depth++] = frame[1];
+      if (frame[0] <= ebp)
+        break;
+      ebp = frame[0];
+    }
+  return depth;
+}
+
+/* Writes the samples in BUF, which holds MAX samples of which
+   CNT were taken, oldest first. */
+static void
+profile_dump (struct sample *buf, size_t max, uint64_t cnt)
+{
+  size_t n = cnt < max ? cnt : max;
+  size_t first = cnt < max ? 0 : cnt % max;
+  char line[128];
+  size_t i;
+
+  snprintf (line, sizeof line, "profile: begin %zu %llu\n",
+            n, cnt - n);
+  serial_puts (line);
+  for (i = 0; i < n; i++)
+    {
+      struct sample *s = &buf[(first + i) % max];
+      int len;
+      int j;
+
+      len = snprintf (line, sizeof line, "profile: %d %c %#"PRIx32,
+                      s->tid, s->user ? 'u' : 'k', s->eip);
+      for (j = 0; j < s->depth; j++)
+        len += snprintf (line + len, sizeof line - len, " %#"PRIx32,
+                         s->stack[j]);
+      snprintf (line + len, sizeof line - len, "\n");
+      serial_puts (line);
+    }
+  serial_puts ("profile: end\n");
+}
+
+/* Writes S to the serial port only, bypassing the VGA console,
+   which would be far too slow for a large dump. */
+static void
+serial_puts (const char *s)
+{
+  while (*s != '\0')
+    serial_putc (*s++);
+}
@@ -0,0 +1,17 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+struct intr_frame;
+
+/* Start profiling at boot?
+   Controlled by kernel command-line option "-profile". */
+extern bool profile_at_boot;
+
+void profile_init (void);
+bool profile_start (void);
+int profile_stop (void);
+void profile_sample (const struct intr_frame *);
+
+#endif /* threads/profile.h */
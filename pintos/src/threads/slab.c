@@ -0,0 +1,300 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator for frequently allocated kernel objects.
+
+   malloc() rounds every request up to a power of 2, so an
+   object a little bigger than one, such as a struct inode with
+   its embedded copy of the on-disk inode, wastes almost half of
+   its block.  A cache created with kmem_cache_create() instead
+   hands out objects of exactly one size, rounded up only for
+   alignment, packed into pages called "slabs".
+
+   Each slab is one page, starting with a struct slab header.
+   The header is followed by an array with one entry per object,
+   which links the free objects into a list by index, and then
+   by the objects themselves.  Keeping the free list out of the
+   objects means that a free object keeps whatever state it had:
+   if the cache has a constructor, it is called once for each
+   object when its slab is created, not on every allocation, and
+   an object must be returned to the cache in its constructed
+   state.
+
+   A cache keeps the slabs that have free objects on a list,
+   partly used slabs first, so that allocations are packed into
+   as few pages as possible.  It keeps one entirely free slab in
+   reserve and gives any others back to the page allocator. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Marks the end of a slab's free list. */
+#define NO_OBJECT UINT16_MAX
+
+/* Alignment of objects. */
+#define SLAB_ALIGN sizeof (void *)
+
+/* A cache. */
+struct kmem_cache
+  {
+    struct list_elem elem;      /* Element in all_caches. */
+    char name[16];              /* Name, for statistics. */
+    char lock_name[24];         /* Lock name, for profiling. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    size_t obj_ofs;             /* Offset of first object in a slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    struct list slabs;          /* Slabs with free objects. */
+    size_t empty_cnt;           /* Slabs with no objects in use. */
+    struct lock lock;           /* Protects the members below. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Slabs allocated. */
+    size_t in_use_cnt;          /* Objects in use. */
+    unsigned alloc_cnt;         /* Allocations. */
+  };
+
+/* Slab header. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's slabs list. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint16_t first_free;        /* Index of first free object. */
+    uint16_t next[];            /* Next free object after each. */
+  };
+
+/* All caches, for statistics.  Protected by disabling
+   interrupts. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+static void *slab_to_obj (struct slab *, size_t idx);
+
+/* Creates and returns a cache of objects SIZE bytes in size.  If
+   CTOR is nonnull, it is called on each object when the object
+   is first created.  Returns a null pointer if memory is not
+   available.  Caches are never destroyed. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor)
+{
+  struct kmem_cache *c;
+  enum intr_level old_level;
+
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+
+  strlcpy (c->name, name, sizeof c->name);
+  c->obj_size = ROUND_UP (size, SLAB_ALIGN);
+  c->ctor = ctor;
+  list_init (&c->slabs);
+  c->empty_cnt = 0;
+  lock_init (&c->lock);
+  snprintf (c->lock_name, sizeof c->lock_name, "slab %s", c->name);
+  lock_set_name (&c->lock, c->lock_name);
+  c->slab_cnt = 0;
+  c->in_use_cnt = 0;
+  c->alloc_cnt = 0;
+
+  /* Fit as many objects as we can after the header and the free
+     list array. */
+  c->objs_per_slab = ((PGSIZE - sizeof (struct slab))
+                      / (c->obj_size + sizeof (uint16_t)));
+  for (;;)
+    {
+      c->obj_ofs = ROUND_UP (sizeof (struct slab)
+                             + c->objs_per_slab * sizeof (uint16_t),
+                             SLAB_ALIGN);
+      if (c->obj_ofs + c->objs_per_slab * c->obj_size <= PGSIZE)
+        break;
+      c->objs_per_slab--;
+    }
+  ASSERT (c->objs_per_slab > 0);
+  ASSERT (c->objs_per_slab < NO_OBJECT);
+
+  old_level = intr_disable ();
+  list_push_back (&all_caches, &c->elem);
+  intr_set_level (old_level);
+
+  return c;
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t idx;
+
+  ASSERT (c != NULL);
+
+  lock_acquire (&c->lock);
+
+  /* If no slab has a free object, create a new slab. */
+  if (list_empty (&c->slabs))
+    {
+      s = slab_create (c);
+      if (s == NULL)
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_back (&c->slabs, &s->elem);
+      c->slab_cnt++;
+      c->empty_cnt++;
+    }
+
+  /* Take the first free object from the first slab. */
+  s = list_entry (list_front (&c->slabs), struct slab, elem);
+  if (s->free_cnt == c->objs_per_slab)
+    c->empty_cnt--;
+  idx = s->first_free;
+  s->first_free = s->next[idx];
+  if (--s->free_cnt == 0)
+    list_remove (&s->elem);
+
+  c->in_use_cnt++;
+  c->alloc_cnt++;
+  lock_release (&c->lock);
+
+  return slab_to_obj (s, idx);
+}
+
+/* Returns OBJ, which must have been obtained from cache C with
+   kmem_cache_alloc(), to C.  If C has a constructor, OBJ must be
+   in its constructed state. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+  size_t idx;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (c, obj);
+  idx = ((uint8_t *) obj - (uint8_t *) s - c->obj_ofs) / c->obj_size;
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it must keep its constructed state. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+
+  /* Put the object on the slab's free list. */
+  s->next[idx] = s->first_free;
+  s->first_free = idx;
+  if (s->free_cnt++ == 0)
+    list_push_front (&c->slabs, &s->elem);
+  c->in_use_cnt--;
+
+  /* If the slab is now entirely unused, keep it at the end of
+     the list as a reserve, or free it if we already have one. */
+  if (s->free_cnt == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      if (c->empty_cnt > 0)
+        {
+          s->magic = 0;
+          palloc_free_page (s);
+          c->slab_cnt--;
+        }
+      else
+        {
+          list_push_back (&c->slabs, &s->elem);
+          c->empty_cnt++;
+        }
+    }
+
+  lock_release (&c->lock);
+}
+
+/* Prints statistics for each cache. */
+void
+kmem_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      printf ("Slab %s: %zu-byte objects, %zu per slab, %zu slabs, "
+              "%zu in use, %u allocations\n",
+              c->name, c->obj_size, c->objs_per_slab, c->slab_cnt,
+              c->in_use_cnt, c->alloc_cnt);
+    }
+}
+
+/* Allocates a new slab for cache C, constructs its objects, and
+   returns it, or a null pointer if memory is not available. */
+static struct slab *
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+  s->first_free = 0;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      s->next[i] = i + 1 < c->objs_per_slab ? i + 1 : NO_OBJECT;
+      if (c->ctor != NULL)
+        c->ctor (slab_to_obj (s, i));
+    }
+  return s;
+}
+
+/* Returns the slab that object OBJ of cache C is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid. */
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT (pg_ofs (obj) >= c->obj_ofs);
+  ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Returns the IDX'th object within slab S. */
+static void *
+slab_to_obj (struct slab *s, size_t idx)
+{
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (idx < s->cache->objs_per_slab);
+  return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
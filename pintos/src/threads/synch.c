@@ -31,6 +31,51 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "devices/timer.h"
+
+/* Semaphores that threads have spent the most time blocked on.
+   Entries hold copies of the counters, not pointers into the
+   semaphores, which may be freed at any time.  When the table is
+   full, a semaphore that has just been waited on displaces the
+   entry with the least waiting time if it has waited longer, so
+   the table approximates the top offenders.  Protected by
+   disabling interrupts. */
+#define SYNCH_HOT_CNT 8
+struct synch_hot
+  {
+    const struct semaphore *sema;       /* Address, for identification. */
+    int64_t wait_ticks;                 /* Ticks blocked while tracked. */
+    unsigned wait_cnt;                  /* Blocking waits while tracked. */
+  };
+static struct synch_hot synch_hot[SYNCH_HOT_CNT];
+
+static void synch_hot_record (const struct semaphore *, int64_t ticks);
+
+/* Contention statistics for a named lock.  Only locks given a
+   name with lock_set_name() are profiled, and such locks must
+   never be freed, since their statistics outlive them in
+   lock_stats[].  All members except NAME are updated only by the
+   lock's holder, so the lock itself protects them. */
+struct lock_stats
+  {
+    const char *name;           /* Name given to lock_set_name(). */
+    unsigned acquire_cnt;       /* Successful acquisitions. */
+    unsigned contended_cnt;     /* Acquisitions that had to wait. */
+    int64_t wait_ticks;         /* Total ticks spent waiting. */
+    int64_t max_wait_ticks;     /* Longest single wait. */
+    int64_t hold_ticks;         /* Total ticks held. */
+    int64_t max_hold_ticks;     /* Longest single hold. */
+    int64_t acquired_at;        /* Tick of the current acquisition. */
+  };
+
+/* Statistics for every named lock. */
+#define LOCK_STATS_MAX 32       /* Most locks that can be named. */
+#define LOCK_STATS_TOP 8        /* Locks shown by lock_print_stats(). */
+static struct lock_stats lock_stats[LOCK_STATS_MAX];
+static size_t lock_stats_cnt;
+
+static void lock_acquired (struct lock *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -48,6 +93,8 @@ sema_init (struct semaphore *sema, unsigned value)
 
   sema->value = value;
   list_init (&sema->waiters);
+  sema->wait_ticks = 0;
+  sema->wait_cnt = 0;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -61,18 +108,77 @@ void
 sema_down (struct semaphore *sema) 
 {
   enum intr_level old_level;
+  int64_t start = -1;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  if (sema->value == 0)
+    start = timer_ticks ();
   while (sema->value == 0) 
     {
       list_push_back (&sema->waiters, &thread_current ()->elem);
       thread_block ();
     }
   sema->value--;
+  if (start >= 0)
+    {
+      int64_t ticks = timer_elapsed (start);
+      sema->wait_ticks += ticks;
+      sema->wait_cnt++;
+      synch_hot_record (sema, ticks);
+    }
+  intr_set_level (old_level);
+}
+
+/* Notes that a thread just spent TICKS blocked on SEMA.
+   Interrupts must be off. */
+static void
+synch_hot_record (const struct semaphore *sema, int64_t ticks)
+{
+  struct synch_hot *h, *slot = NULL, *min = synch_hot;
+
+  for (h = synch_hot; h < synch_hot + SYNCH_HOT_CNT; h++)
+    if (h->sema == sema)
+      {
+        slot = h;
+        break;
+      }
+    else if (h->sema == NULL || h->wait_ticks < min->wait_ticks)
+      min = h;
+  if (slot == NULL && (min->sema == NULL || min->wait_ticks < ticks))
+    {
+      slot = min;
+      slot->sema = sema;
+      slot->wait_ticks = 0;
+      slot->wait_cnt = 0;
+    }
+  if (slot != NULL)
+    {
+      slot->wait_ticks += ticks;
+      slot->wait_cnt++;
+    }
+}
+
+/* Prints the semaphores and locks that threads have spent the
+   most time blocked on.  Addresses can be matched against the
+   kernel's symbol table. */
+void
+synch_print_stats (void)
+{
+  struct synch_hot hot[SYNCH_HOT_CNT];
+  enum intr_level old_level;
+  int i;
+
+  old_level = intr_disable ();
+  memcpy (hot, synch_hot, sizeof hot);
   intr_set_level (old_level);
+
+  for (i = 0; i < SYNCH_HOT_CNT; i++)
+    if (hot[i].sema != NULL)
+      printf ("Synch: %p blocked %u times for %lld ticks\n",
+              hot[i].sema, hot[i].wait_cnt, hot[i].wait_ticks);
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -179,6 +285,31 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->stats = NULL;
+}
+
+/* Gives LOCK, which must already be initialized, the given NAME
+   and starts profiling its contention.  NAME must remain valid,
+   and LOCK must not be freed, for as long as the kernel runs.
+   Statistics are printed by lock_print_stats().  Once
+   LOCK_STATS_MAX locks have been named, further locks are
+   silently left unprofiled. */
+void
+lock_set_name (struct lock *lock, const char *name)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+  ASSERT (lock->stats == NULL);
+
+  old_level = intr_disable ();
+  if (lock_stats_cnt < LOCK_STATS_MAX)
+    {
+      lock->stats = &lock_stats[lock_stats_cnt++];
+      lock->stats->name = name;
+    }
+  intr_set_level (old_level);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -196,8 +327,28 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  sema_down (&lock->semaphore);
+  if (lock->stats == NULL && !trace_enabled (TRACE_LOCK))
+    sema_down (&lock->semaphore);
+  else if (!sema_try_down (&lock->semaphore))
+    {
+      struct lock_stats *ls = lock->stats;
+      int64_t start = timer_ticks ();
+      int64_t wait;
+
+      trace (TRACE_LOCK, TRACE_LOCK_WAIT, (uintptr_t) lock, 0);
+      sema_down (&lock->semaphore);
+      wait = timer_elapsed (start);
+      trace (TRACE_LOCK, TRACE_LOCK_ACQUIRE, (uintptr_t) lock, wait);
+      if (ls != NULL)
+        {
+          ls->contended_cnt++;
+          ls->wait_ticks += wait;
+          if (wait > ls->max_wait_ticks)
+            ls->max_wait_ticks = wait;
+        }
+    }
   lock->holder = thread_current ();
+  lock_acquired (lock);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -216,10 +367,27 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      lock_acquired (lock);
+    }
   return success;
 }
 
+/* Updates the statistics of LOCK, if it is named, for an
+   acquisition that just succeeded. */
+static void
+lock_acquired (struct lock *lock)
+{
+  struct lock_stats *ls = lock->stats;
+
+  if (ls != NULL)
+    {
+      ls->acquire_cnt++;
+      ls->acquired_at = timer_ticks ();
+    }
+}
+
 /* Releases LOCK, which must be owned by the current thread.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -231,6 +399,15 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  if (lock->stats != NULL)
+    {
+      struct lock_stats *ls = lock->stats;
+      int64_t hold = timer_elapsed (ls->acquired_at);
+
+      ls->hold_ticks += hold;
+      if (hold > ls->max_hold_ticks)
+        ls->max_hold_ticks = hold;
+    }
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
@@ -246,6 +423,51 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Prints the named locks with the most time spent waiting for
+   them, up to LOCK_STATS_TOP of them. */
+void
+lock_print_stats (void)
+{
+  struct lock_stats *top[LOCK_STATS_TOP];
+  size_t top_cnt = 0;
+  size_t i, j;
+
+  /* Insertion sort into TOP by descending wait time, with the
+     number of contended acquisitions breaking ties. */
+  for (i = 0; i < lock_stats_cnt; i++)
+    {
+      struct lock_stats *ls = &lock_stats[i];
+      if (ls->acquire_cnt == 0)
+        continue;
+      for (j = top_cnt; j > 0; j--)
+        {
+          struct lock_stats *prev = top[j - 1];
+          if (prev->wait_ticks > ls->wait_ticks
+              || (prev->wait_ticks == ls->wait_ticks
+                  && prev->contended_cnt >= ls->contended_cnt))
+            break;
+          if (j < LOCK_STATS_TOP)
+            top[j] = prev;
+        }
+      if (j < LOCK_STATS_TOP)
+        {
+          top[j] = ls;
+          if (top_cnt < LOCK_STATS_TOP)
+            top_cnt++;
+        }
+    }
+
+  for (i = 0; i < top_cnt; i++)
+    {
+      struct lock_stats *ls = top[i];
+      printf ("Lock %s: %u acquisitions, %u contended, "
+              "wait %lld ticks (max %lld), held %lld ticks (max %lld)\n",
+              ls->name, ls->acquire_cnt, ls->contended_cnt,
+              ls->wait_ticks, ls->max_wait_ticks,
+              ls->hold_ticks, ls->max_hold_ticks);
+    }
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem 
   {
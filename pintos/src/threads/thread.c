@@ -1,5 +1,6 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
@@ -10,7 +11,9 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -20,9 +23,44 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Random value stored in the word just past struct thread, at
+   the very bottom of the kernel stack.  A stack that overflows
+   overwrites it before it reaches struct thread itself. */
+#define THREAD_CANARY 0x5ca1ab1e
+
+/* Stride scheduling.  A thread's stride is STRIDE1 divided by
+   its tickets, so that a thread holding twice the tickets
+   advances its pass half as fast and runs twice as often. */
+#define STRIDE1 (1 << 20)
+
+/* Most threads a stride scheduling heap holds.  Under the stride
+   scheduler, thread_create() refuses to create more threads than
+   this, so that a heap can never overflow. */
+#define STRIDE_HEAP_MAX 1024
+
+/* The run queue.  Protected by disabling interrupts. */
+struct run_queue
+  {
+    size_t ready_cnt;                   /* Number of ready threads. */
+
+    /* Processes in THREAD_READY state, that is, processes that
+       are ready to run but not actually running. */
+    struct list ready_list;
+
+    /* Ready processes when thread_stride is true, kept as a
+       binary min-heap ordered by pass value instead of in
+       ready_list. */
+    struct thread *stride_heap[STRIDE_HEAP_MAX];
+
+    /* Pass value of the most recently scheduled thread.  A
+       thread joining the queue starts no earlier than this, so
+       that it cannot monopolize the CPU after sleeping for a
+       long time. */
+    int64_t global_pass;
+  };
+
+/* Threads ready to run. */
+static struct run_queue ready_queue;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -31,12 +69,45 @@ static struct list all_list;
 /* Idle thread. */
 static struct thread *idle_thread;
 
+/* Number of threads that exist, from creation until their pages
+   are freed, including the initial thread. */
+static size_t thread_cnt = 1;
+
+/* Scheduling statistics of every thread that has exited. */
+static struct schedstat exited_stats;
+
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Cache of free thread pages.
+
+   Rather than going back to the page allocator every time a
+   thread exits and is created, dying threads leave their pages
+   here, and thread_create() takes them back.  A page is prepared
+   as it goes into the cache: its struct thread is cleared and
+   given its magic number and stack canary, so that creating a
+   thread from a cached page needs neither the page allocator nor
+   a memset().  Pages beyond THREAD_CACHE_MAX go back to palloc
+   as before.
+
+   So that a burst of thread creation finds prepared pages even
+   before any thread has exited, the idle thread also tops the
+   cache up from palloc, one page at a time.  palloc drains the
+   cache through thread_cache_drain(), registered as its reclaim
+   hook, when the kernel pool runs out. */
+#define THREAD_CACHE_MAX 8      /* Pages kept at most. */
+static struct thread_cache
+  {
+    void *pages[THREAD_CACHE_MAX];      /* Prepared pages. */
+    size_t page_cnt;
+    long long hits;             /* Creations served from the cache. */
+    long long misses;           /* Creations that called palloc. */
+  }
+thread_cache;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame
   {
@@ -59,15 +130,33 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the stride scheduler.
+   Controlled by kernel command-line option "-stride". */
+bool thread_stride;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
+static uint32_t *thread_canary (struct thread *);
+static void thread_page_prepare (struct thread *);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
+static bool thread_cache_refill (void);
+static size_t thread_cache_drain (void);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
+static void run_queue_init (struct run_queue *);
+static void run_queue_push (struct run_queue *, struct thread *);
+static struct thread *run_queue_pop (struct run_queue *);
+static void stride_heap_push (struct run_queue *, struct thread *);
+static struct thread *stride_heap_pop (struct run_queue *);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
+static void schedstat_switch (struct thread *cur, struct thread *next);
+static void print_schedstats (void);
+static void schedstat_add (struct schedstat *, const struct schedstat *);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
 
@@ -90,13 +179,16 @@ thread_init (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  run_queue_init (&ready_queue);
   list_init (&all_list);
+  palloc_register_reclaim (thread_cache_drain);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
+  thread_page_prepare (initial_thread);
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
+  initial_thread->started = true;
   initial_thread->tid = allocate_tid ();
   initial_thread->cwd = NULL;
 }
@@ -135,9 +227,16 @@ thread_tick (void)
   else
     kernel_ticks++;
 
+  /* Charge the running thread for the tick it used. */
+  if (t != idle_thread)
+    t->pass += t->stride;
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
-    intr_yield_on_return ();
+    {
+      t->preempted = true;
+      intr_yield_on_return ();
+    }
 }
 
 /* Prints thread statistics. */
@@ -146,6 +245,9 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld page cache hits, %lld misses\n",
+          thread_cache.hits, thread_cache.misses);
+  print_schedstats ();
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -171,19 +273,39 @@ thread_create (const char *name, int priority,
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
+  enum intr_level old_level;
+  bool full;
   tid_t tid;
 
   ASSERT (function != NULL);
 
+  /* Count the new thread, unless that would allow more ready
+     threads than a stride scheduling heap holds. */
+  old_level = intr_disable ();
+  full = thread_stride && thread_cnt >= STRIDE_HEAP_MAX;
+  if (!full)
+    thread_cnt++;
+  intr_set_level (old_level);
+  if (full)
+    return TID_ERROR;
+
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_get ();
   if (t == NULL)
-    return TID_ERROR;
+    {
+      old_level = intr_disable ();
+      thread_cnt--;
+      intr_set_level (old_level);
+      return TID_ERROR;
+    }
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
   t->child = aux;
+  t->tickets = thread_current ()->tickets;
+  t->stride = STRIDE1 / t->tickets;
+  t->since = timer_ticks ();
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -239,11 +361,79 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
   t->status = THREAD_READY;
+  if (t->started)
+    {
+      /* A thread being unblocked for the first time, by
+         thread_create(), has not really been waiting. */
+      int64_t now = timer_ticks ();
+      t->stats.blocked_ticks += now - t->since;
+      t->stats.wakeups++;
+      t->since = now;
+      t->woken = true;
+    }
+  run_queue_push (&ready_queue, t);
   intr_set_level (old_level);
 }
 
+/* Copies the scheduling statistics of the thread with the given
+   TID into *ST and returns true.  If TID is SCHEDSTAT_ALL, *ST
+   receives the totals of all threads that have ever run instead.
+   Returns false if no thread with TID exists. */
+bool
+thread_get_schedstat (tid_t tid, struct schedstat *st)
+{
+  enum intr_level old_level;
+  struct list_elem *e;
+  bool found = tid == SCHEDSTAT_ALL;
+
+  memset (st, 0, sizeof *st);
+  old_level = intr_disable ();
+  if (tid == SCHEDSTAT_ALL)
+    schedstat_add (st, &exited_stats);
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      if (tid == SCHEDSTAT_ALL)
+        schedstat_add (st, &t->stats);
+      else if (t->tid == tid)
+        {
+          *st = t->stats;
+          found = true;
+          break;
+        }
+    }
+  intr_set_level (old_level);
+
+  return found;
+}
+
+/* Prints the system-wide scheduling statistics and the wakeup
+   latency histogram. */
+static void
+print_schedstats (void)
+{
+  struct schedstat st;
+  int i;
+
+  thread_get_schedstat (SCHEDSTAT_ALL, &st);
+  printf ("Sched: %lld run ticks, %lld ready ticks, %lld blocked ticks\n",
+          st.run_ticks, st.ready_ticks, st.blocked_ticks);
+  printf ("Sched: %"PRIu32" voluntary, %"PRIu32" involuntary switches, "
+          "%"PRIu32" wakeups\n", st.voluntary, st.involuntary, st.wakeups);
+  printf ("Sched: wakeup latency (ticks):");
+  for (i = 0; i < SCHEDSTAT_BUCKETS; i++)
+    {
+      int lo = i == 0 ? 0 : 1 << (i - 1);
+      if (i == SCHEDSTAT_BUCKETS - 1)
+        printf (" %d+:%"PRIu32, lo, st.latency[i]);
+      else
+        printf (" %d:%"PRIu32, lo, st.latency[i]);
+    }
+  printf ("\n");
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void)
@@ -270,6 +460,16 @@ thread_current (void)
   return t;
 }
 
+/* Returns the tid of the running thread, or 0 before
+   thread_init() has been called.  Unlike thread_tid(), this may
+   be called while the running thread is between states, as the
+   scheduler does. */
+tid_t
+thread_running_tid (void)
+{
+  return initial_thread != NULL ? running_thread ()->tid : 0;
+}
+
 /* Returns the running thread's tid. */
 tid_t
 thread_tid (void)
@@ -309,9 +509,9 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread)
-    list_push_back (&ready_list, &cur->elem);
   cur->status = THREAD_READY;
+  if (cur != idle_thread)
+    run_queue_push (&ready_queue, cur);
   schedule ();
   intr_set_level (old_level);
 }
@@ -347,6 +547,29 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
+/* Returns the current thread's stride scheduling tickets. */
+int
+thread_get_tickets (void)
+{
+  return thread_current ()->tickets;
+}
+
+/* Gives the current thread TICKETS stride scheduling tickets,
+   changing its share of the CPU from the next tick on.  Returns
+   false without changing anything if TICKETS is out of range. */
+bool
+thread_set_tickets (int tickets)
+{
+  struct thread *cur = thread_current ();
+
+  if (tickets < TICKETS_MIN || tickets > TICKETS_MAX)
+    return false;
+
+  cur->tickets = tickets;
+  cur->stride = STRIDE1 / tickets;
+  return true;
+}
+
 /* Sets the current thread's nice value to NICE. */
 void
 thread_set_nice (int nice UNUSED)
@@ -382,11 +605,11 @@ thread_get_recent_cpu (void)
 
    The idle thread is initially put on the ready list by
    thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   point it initializes idle_thread, "up"s the semaphore
+   passed to it to enable thread_start() to continue, and
+   immediately blocks.  After that, the idle thread never appears
+   in the ready list.  It is returned by next_thread_to_run() as
+   a special case when no ready thread can be found. */
 static void
 idle (void *idle_started_ UNUSED)
 {
@@ -400,6 +623,14 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* With nothing else to run, zero a free page for palloc
+         or prepare one for thread_create(), then look again for
+         something to run. */
+      intr_enable ();
+      if (palloc_prezero () || thread_cache_refill ())
+        continue;
+      intr_disable ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -416,6 +647,122 @@ idle (void *idle_started_ UNUSED)
     }
 }
 
+/* Clears the struct thread at the start of thread page T and
+   sets its magic number and stack canary, as init_thread()
+   expects. */
+static void
+thread_page_prepare (struct thread *t)
+{
+  memset (t, 0, sizeof *t);
+  t->magic = THREAD_MAGIC;
+  *thread_canary (t) = THREAD_CANARY;
+}
+
+/* Returns a prepared page for a new thread, from the thread page
+   cache if possible, otherwise from palloc.  Returns a null
+   pointer if no memory is available. */
+static struct thread *
+thread_page_get (void)
+{
+  struct thread_cache *tc = &thread_cache;
+  enum intr_level old_level;
+  struct thread *t = NULL;
+
+  old_level = intr_disable ();
+  if (tc->page_cnt > 0)
+    {
+      t = tc->pages[--tc->page_cnt];
+      tc->hits++;
+    }
+  else
+    tc->misses++;
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    {
+      t = palloc_get_page (0);
+      if (t != NULL)
+        thread_page_prepare (t);
+    }
+  return t;
+}
+
+/* Prepares dead thread T's page for reuse and returns it to the
+   thread page cache, or to palloc if the cache is full.  Called
+   from the scheduler with interrupts off. */
+static void
+thread_page_put (struct thread *t)
+{
+  struct thread_cache *tc = &thread_cache;
+  bool cached = false;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  thread_page_prepare (t);
+  if (tc->page_cnt < THREAD_CACHE_MAX)
+    {
+      tc->pages[tc->page_cnt++] = t;
+      cached = true;
+    }
+
+  if (!cached)
+    palloc_free_page (t);
+}
+
+/* Adds one prepared page from palloc to the thread page cache,
+   if it has room.  Returns true if successful, false if the cache
+   is full or memory is short.  Called by the idle thread, so it
+   never blocks. */
+static bool
+thread_cache_refill (void)
+{
+  struct thread_cache *tc = &thread_cache;
+  enum intr_level old_level;
+  struct thread *t;
+  bool cached = false;
+
+  if (tc->page_cnt >= THREAD_CACHE_MAX)
+    return false;
+
+  t = palloc_get_page (0);
+  if (t == NULL)
+    return false;
+  thread_page_prepare (t);
+
+  old_level = intr_disable ();
+  if (tc->page_cnt < THREAD_CACHE_MAX)
+    {
+      tc->pages[tc->page_cnt++] = t;
+      cached = true;
+    }
+  intr_set_level (old_level);
+
+  if (!cached)
+    palloc_free_page (t);
+  return cached;
+}
+
+/* Returns every page in the thread page cache to palloc.
+   Returns the number of pages freed.  palloc's reclaim hook. */
+static size_t
+thread_cache_drain (void)
+{
+  struct thread_cache *tc = &thread_cache;
+  void *pages[THREAD_CACHE_MAX];
+  enum intr_level old_level;
+  size_t cnt, i;
+
+  old_level = intr_disable ();
+  cnt = tc->page_cnt;
+  memcpy (pages, tc->pages, cnt * sizeof *pages);
+  tc->page_cnt = 0;
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    palloc_free_page (pages[i]);
+  return cnt;
+}
+
 /* Function used as the basis for a kernel thread. */
 static void
 kernel_thread (thread_func *function, void *aux)
@@ -445,11 +792,19 @@ running_thread (void)
 static bool
 is_thread (struct thread *t)
 {
-  return t != NULL && t->magic == THREAD_MAGIC;
+  return (t != NULL && t->magic == THREAD_MAGIC
+          && *thread_canary (t) == THREAD_CANARY);
+}
+
+/* Returns the address of thread T's stack canary. */
+static uint32_t *
+thread_canary (struct thread *t)
+{
+  return (uint32_t *) (t + 1);
 }
 
 /* Does basic initialization of T as a blocked thread named
-   NAME. */
+   NAME.  T must have been prepared by thread_page_prepare(). */
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
@@ -458,15 +813,20 @@ init_thread (struct thread *t, const char *name, int priority)
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
+  ASSERT (is_thread (t));
 
-  memset (t, 0, sizeof *t);
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
-  t->magic = THREAD_MAGIC;
+  t->tickets = TICKETS_DEFAULT;
+  t->stride = STRIDE1 / TICKETS_DEFAULT;
+  t->io_inode = TRACE_NO_INODE;
 
   list_init(&t->children);
+#ifdef VM
+  list_init (&t->mappings);
+#endif
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -494,10 +854,111 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void)
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
+  struct thread *t = run_queue_pop (&ready_queue);
+  return t != NULL ? t : idle_thread;
+}
+
+/* Initializes RQ as an empty run queue. */
+static void
+run_queue_init (struct run_queue *rq)
+{
+  rq->ready_cnt = 0;
+  list_init (&rq->ready_list);
+  rq->global_pass = 0;
+}
+
+/* Adds T, which must be ready to run, to RQ in the order used by
+   the active scheduler.  Interrupts must be off. */
+static void
+run_queue_push (struct run_queue *rq, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_stride)
+    {
+      if (t->pass < rq->global_pass)
+        t->pass = rq->global_pass;
+      stride_heap_push (rq, t);
+    }
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    list_push_back (&rq->ready_list, &t->elem);
+  rq->ready_cnt++;
+}
+
+/* Removes and returns the next thread to run from RQ, or a null
+   pointer if RQ is empty.  Interrupts must be off. */
+static struct thread *
+run_queue_pop (struct run_queue *rq)
+{
+  struct thread *t = NULL;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (rq->ready_cnt > 0)
+    {
+      if (thread_stride)
+        {
+          t = stride_heap_pop (rq);
+          rq->global_pass = t->pass;
+        }
+      else
+        t = list_entry (list_pop_front (&rq->ready_list),
+                        struct thread, elem);
+      rq->ready_cnt--;
+    }
+  return t;
+}
+
+/* Inserts T into RQ's stride scheduling heap.  Interrupts must
+   be off. */
+static void
+stride_heap_push (struct run_queue *rq, struct thread *t)
+{
+  size_t i;
+
+  /* thread_create() keeps the number of threads below this. */
+  ASSERT (rq->ready_cnt < STRIDE_HEAP_MAX);
+
+  /* Sift up from the new last slot. */
+  for (i = rq->ready_cnt; i > 0; i = (i - 1) / 2)
+    {
+      struct thread *parent = rq->stride_heap[(i - 1) / 2];
+      if (parent->pass <= t->pass)
+        break;
+      rq->stride_heap[i] = parent;
+    }
+  rq->stride_heap[i] = t;
+}
+
+/* Removes and returns the thread with the smallest pass value
+   from RQ's stride scheduling heap, which must not be empty.
+   Interrupts must be off.  The caller is responsible for
+   decrementing RQ's ready_cnt afterward. */
+static struct thread *
+stride_heap_pop (struct run_queue *rq)
+{
+  struct thread **heap = rq->stride_heap;
+  struct thread *min, *last;
+  size_t cnt = rq->ready_cnt - 1;
+  size_t i, child;
+
+  ASSERT (rq->ready_cnt > 0);
+
+  min = heap[0];
+  last = heap[cnt];
+
+  /* Sift the old last element down from the root. */
+  for (i = 0; (child = 2 * i + 1) < cnt; i = child)
+    {
+      if (child + 1 < cnt && heap[child + 1]->pass < heap[child]->pass)
+        child++;
+      if (last->pass <= heap[child]->pass)
+        break;
+      heap[i] = heap[child];
+    }
+  heap[i] = last;
+
+  return min;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -539,10 +1000,12 @@ thread_schedule_tail (struct thread *prev)
      pull out the rug under itself.  (We don't free
      initial_thread because its memory was not obtained via
      palloc().) */
-  if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
+  if (prev != NULL && prev->status == THREAD_DYING)
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_cnt--;
+      if (prev != initial_thread)
+        thread_page_put (prev);
     }
 }
 
@@ -564,11 +1027,81 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  schedstat_switch (cur, next);
+
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      trace (TRACE_SCHED, TRACE_SCHED_SWITCH, cur->tid, next->tid);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
+/* Charges CUR, which is giving up the CPU, and NEXT, which is
+   about to run, for the time since their last state change.  If
+   CUR is dying, its statistics are folded into exited_stats.
+   Nothing is charged if CUR keeps running, as when it yields
+   with no other thread ready, since no switch happens. */
+static void
+schedstat_switch (struct thread *cur, struct thread *next)
+{
+  int64_t now = timer_ticks ();
+
+  if (cur == next)
+    {
+      cur->preempted = false;
+      return;
+    }
+
+  cur->stats.run_ticks += now - cur->since;
+  cur->since = now;
+  if (cur->status == THREAD_READY && cur->preempted)
+    cur->stats.involuntary++;
+  else if (cur->status != THREAD_DYING)
+    cur->stats.voluntary++;
+  cur->preempted = false;
+
+  if (next->status == THREAD_READY)
+    {
+      int64_t wait = now - next->since;
+      next->stats.ready_ticks += wait;
+      if (next->woken)
+        {
+          int bucket = 0;
+          while (wait > 0 && bucket < SCHEDSTAT_BUCKETS - 1)
+            {
+              wait >>= 1;
+              bucket++;
+            }
+          next->stats.latency[bucket]++;
+          next->woken = false;
+        }
+    }
+  next->since = now;
+  next->started = true;
+
+  if (cur->status == THREAD_DYING)
+    {
+      schedstat_add (&exited_stats, &cur->stats);
+    }
+}
+
+/* Adds the statistics in B to those in A. */
+static void
+schedstat_add (struct schedstat *a, const struct schedstat *b)
+{
+  int i;
+
+  a->run_ticks += b->run_ticks;
+  a->ready_ticks += b->ready_ticks;
+  a->blocked_ticks += b->blocked_ticks;
+  a->voluntary += b->voluntary;
+  a->involuntary += b->involuntary;
+  a->wakeups += b->wakeups;
+  for (i = 0; i < SCHEDSTAT_BUCKETS; i++)
+    a->latency[i] += b->latency[i];
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void)
@@ -3,6 +3,7 @@
 
 #include <debug.h>
 #include <list.h>
+#include <schedstat.h>
 #include <stdint.h>
 #include "threads/synch.h"
 #include "threads/fixed-point.h"
@@ -26,6 +27,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Stride scheduling tickets. */
+#define TICKETS_MIN 1                   /* Fewest tickets. */
+#define TICKETS_DEFAULT 100             /* Default tickets. */
+#define TICKETS_MAX 10000               /* Most tickets. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -90,6 +96,14 @@ struct thread
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
+    int tickets;                        /* Stride scheduling tickets. */
+    int64_t stride;                     /* Pass advance per tick run. */
+    int64_t pass;                       /* Stride scheduling virtual time. */
+    struct schedstat stats;             /* Scheduling statistics. */
+    int64_t since;                      /* Tick of last state change. */
+    bool started;                       /* Has run at least once? */
+    bool woken;                         /* Unblocked but not yet run? */
+    bool preempted;                     /* Time slice used up? */
     struct list_elem allelem;           /* List element for all threads list. */
 
     struct file *file_des[128];          /* File descriptors. */
@@ -104,8 +118,21 @@ struct thread
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
 #endif
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash *pages;                 /* Supplemental page table. */
+    const void *user_esp;               /* User stack pointer on entry
+                                           to the current system call. */
+    const void *pinned_uaddr;           /* Start of pinned user memory. */
+    size_t pinned_size;                 /* Size of pinned user memory. */
+
+    /* Owned by vm/mmap.c. */
+    struct list mappings;               /* Memory-mapped files. */
+    int next_mapid;                     /* Id for the next mapping. */
+#endif
 
     struct dir *cwd;                    /* Current working directory of the thread. */
+    uint32_t io_inode;                  /* Inode being read or written, for tracing. */
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -127,6 +154,12 @@ struct child_thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the proportional-share stride scheduler, which
+   divides CPU time among ready threads in proportion to their
+   tickets.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
 void thread_init (void);
 void thread_start (void);
 
@@ -140,6 +173,7 @@ void thread_block (void);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
+tid_t thread_running_tid (void);
 tid_t thread_tid (void);
 const char *thread_name (void);
 
@@ -158,4 +192,9 @@ void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
+bool thread_get_schedstat (tid_t, struct schedstat *);
+
+int thread_get_tickets (void);
+bool thread_set_tickets (int);
+
 #endif /* threads/thread.h */
@@ -0,0 +1,283 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/serial.h"
+#include "devices/timer.h"
+#ifdef FILESYS
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#endif
+
+/* Kernel event tracing.
+
+   Tracepoints throughout the kernel call trace(), which records
+   a fixed-size event into a ring buffer if the event's category
+   was enabled with the "-trace" option.  Recording takes neither
+   locks nor the console, only a brief interrupt-disabled window,
+   so tracing barely changes the timing being studied.  When the
+   buffer is full, the oldest events are overwritten.
+
+   trace_dump() drains the buffer, oldest event first, into a
+   file or, as hex, to the serial port.  utils/pintos-trace
+   decodes either form.  The dump is a struct trace_header
+   followed by HEADER.RECORD_CNT struct trace_records, all little
+   endian. */
+
+/* Pages in the trace buffer. */
+#define TRACE_PAGES 32
+
+/* One traced event. */
+struct trace_record
+  {
+    uint64_t tsc;               /* Time stamp counter. */
+    uint16_t event;             /* enum trace_event. */
+    uint16_t tid;               /* Running thread. */
+    uint32_t a, b;              /* Event arguments. */
+  };
+
+/* Header of a trace dump.  TSC_KHZ lets the decoder convert time
+   stamps into seconds.  The two (TSC, ticks) pairs allow a rough
+   conversion even if the TSC was never calibrated. */
+#define TRACE_MAGIC 0x43525450  /* "PTRC". */
+#define TRACE_VERSION 1
+struct trace_header
+  {
+    uint32_t magic;             /* TRACE_MAGIC. */
+    uint16_t version;           /* TRACE_VERSION. */
+    uint16_t record_size;       /* sizeof (struct trace_record). */
+    uint32_t record_cnt;        /* Records following the header. */
+    uint32_t lost_cnt;          /* Older records overwritten. */
+    uint32_t timer_freq;        /* Timer ticks per second. */
+    uint32_t tsc_khz;           /* TSC rate in kHz, 0 if unknown. */
+    uint64_t start_tsc;         /* TSC when tracing started. */
+    int64_t start_ticks;        /* Timer ticks when tracing started. */
+    uint64_t end_tsc;           /* TSC when the dump was taken. */
+    int64_t end_ticks;          /* Timer ticks when the dump was taken. */
+  };
+
+/* Categories being recorded. */
+unsigned trace_mask;
+
+/* Categories requested on the command line. */
+static unsigned trace_requested;
+
+/* Trace buffer, which holds TRACE_MAX records of which
+   TRACE_CNT have been written.  Protected by disabling
+   interrupts. */
+#define TRACE_MAX (TRACE_PAGES * PGSIZE / sizeof (struct trace_record))
+static struct trace_record *trace_buf;
+static uint64_t trace_cnt;
+
+/* Start of the current trace. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+static void trace_restart (void);
+static void serial_hex (const void *, size_t);
+
+/* Enables the comma-separated trace CATEGORIES, which may
+   include "cache", "ide", "syscall", "sched", "lock", "block",
+   and "all".  Called while parsing the kernel command line, so
+   tracing does not actually begin until trace_init(). */
+void
+trace_configure (char *categories)
+{
+  static const struct
+    {
+      const char *name;
+      unsigned mask;
+    }
+  names[] =
+    {
+      {"cache", TRACE_CACHE},
+      {"ide", TRACE_IDE},
+      {"syscall", TRACE_SYSCALL},
+      {"sched", TRACE_SCHED},
+      {"lock", TRACE_LOCK},
+      {"block", TRACE_BLOCK},
+      {"all", -1u},
+    };
+  char *name, *save_ptr;
+
+  if (categories == NULL)
+    PANIC ("-trace requires a list of categories (use -h for help)");
+  for (name = strtok_r (categories, ",", &save_ptr); name != NULL;
+       name = strtok_r (NULL, ",", &save_ptr))
+    {
+      size_t i;
+
+      for (i = 0; i < sizeof names / sizeof *names; i++)
+        if (!strcmp (name, names[i].name))
+          break;
+      if (i >= sizeof names / sizeof *names)
+        PANIC ("unknown trace category `%s' (use -h for help)", name);
+      trace_requested |= names[i].mask;
+    }
+}
+
+/* Allocates the trace buffer and starts recording the
+   categories selected by trace_configure(), if any.  Must be
+   called after the page allocator is initialized. */
+void
+trace_init (void)
+{
+  if (trace_requested == 0)
+    return;
+
+  trace_buf = palloc_get_multiple (0, TRACE_PAGES);
+  if (trace_buf == NULL)
+    {
+      printf ("trace: not enough memory for trace buffer\n");
+      return;
+    }
+  trace_restart ();
+}
+
+/* Starts a new trace, discarding any recorded events. */
+static void
+trace_restart (void)
+{
+  enum intr_level old_level = intr_disable ();
+  trace_cnt = 0;
+  start_tsc = timer_cycles ();
+  start_ticks = timer_ticks ();
+  trace_mask = trace_requested;
+  intr_set_level (old_level);
+}
+
+/* Records EVENT with arguments A and B.  Use trace() instead,
+   which only calls this if the event's category is enabled.
+   May be called from any context, including interrupt handlers
+   and the scheduler. */
+void
+trace_record (enum trace_event event, uint32_t a, uint32_t b)
+{
+  enum intr_level old_level = intr_disable ();
+  if (trace_buf != NULL)
+    {
+      struct trace_record *r = &trace_buf[trace_cnt++ % TRACE_MAX];
+
+      r->tsc = timer_cycles ();
+      r->event = event;
+      r->tid = thread_running_tid ();
+      r->a = a;
+      r->b = b;
+    }
+  intr_set_level (old_level);
+}
+
+/* Drains the trace buffer into FILE_NAME, which is created, or
+   to the serial port as "trace:" lines of hex if FILE_NAME is a
+   null pointer, and starts a new trace.  Returns the number of
+   records written, or -1 if tracing is off or the file cannot be
+   written. */
+int
+trace_dump (const char *file_name)
+{
+  struct trace_header h;
+  enum intr_level old_level;
+  size_t first, i;
+  int result;
+
+  if (trace_buf == NULL)
+    return -1;
+
+  /* Stop recording, so that the dump itself, and any events
+     that happen meanwhile, do not change the buffer. */
+  old_level = intr_disable ();
+  trace_mask = 0;
+  h.magic = TRACE_MAGIC;
+  h.version = TRACE_VERSION;
+  h.record_size = sizeof (struct trace_record);
+  h.record_cnt = trace_cnt < TRACE_MAX ? trace_cnt : TRACE_MAX;
+  h.lost_cnt = trace_cnt - h.record_cnt;
+  h.timer_freq = TIMER_FREQ;
+  h.tsc_khz = timer_cycles_per_sec () / 1000;
+  h.start_tsc = start_tsc;
+  h.start_ticks = start_ticks;
+  h.end_tsc = timer_cycles ();
+  h.end_ticks = timer_ticks ();
+  first = trace_cnt < TRACE_MAX ? 0 : trace_cnt % TRACE_MAX;
+  intr_set_level (old_level);
+
+  result = h.record_cnt;
+  if (file_name == NULL)
+    {
+      serial_hex (&h, sizeof h);
+      for (i = 0; i < h.record_cnt; i++)
+        serial_hex (&trace_buf[(first + i) % TRACE_MAX],
+                    sizeof *trace_buf);
+      serial_hex (NULL, 0);
+    }
+  else
+    {
+#ifdef FILESYS
+      size_t size = sizeof h + h.record_cnt * sizeof *trace_buf;
+      struct file *file;
+
+      if (!filesys_create (file_name, size, false)
+          || (file = filesys_open (file_name)) == NULL)
+        result = -1;
+      else
+        {
+          /* Write the records in at most two runs, split where
+             the ring wraps around. */
+          size_t run = TRACE_MAX - first;
+          if (run > h.record_cnt)
+            run = h.record_cnt;
+          file_write (file, &h, sizeof h);
+          file_write (file, trace_buf + first, run * sizeof *trace_buf);
+          file_write (file, trace_buf,
+                      (h.record_cnt - run) * sizeof *trace_buf);
+          file_close (file);
+        }
+#else
+      result = -1;
+#endif
+    }
+
+  trace_restart ();
+  return result;
+}
+
+/* Writes the SIZE bytes at P to the serial port in hex, 32 bytes
+   to a "trace:" line.  Output is buffered across calls until
+   called with SIZE 0, which flushes it and marks the end of the
+   dump. */
+static void
+serial_hex (const void *p_, size_t size)
+{
+  static const char digits[] = "0123456789abcdef";
+  static size_t col;
+  const uint8_t *p = p_;
+  const char *s;
+
+  if (size == 0)
+    {
+      if (col > 0)
+        serial_putc ('\n');
+      for (s = "trace: end\n"; *s != '\0'; s++)
+        serial_putc (*s);
+      col = 0;
+      return;
+    }
+
+  for (; size > 0; size--, p++)
+    {
+      if (col == 0)
+        for (s = "trace: "; *s != '\0'; s++)
+          serial_putc (*s);
+      serial_putc (digits[*p >> 4]);
+      serial_putc (digits[*p & 15]);
+      if (++col == 32)
+        {
+          serial_putc ('\n');
+          col = 0;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Trace categories, selected with the "-trace" kernel option. */
+enum trace_category
+  {
+    TRACE_CACHE = 1 << 0,       /* Buffer cache lookups. */
+    TRACE_IDE = 1 << 1,         /* IDE disk requests. */
+    TRACE_SYSCALL = 1 << 2,     /* System call entry and exit. */
+    TRACE_SCHED = 1 << 3,       /* Context switches. */
+    TRACE_LOCK = 1 << 4,        /* Waits for locks. */
+    TRACE_BLOCK = 1 << 5        /* File system device I/O. */
+  };
+
+/* Trace events.  The values are part of the dump format read by
+   utils/pintos-trace, so new events go at the end. */
+enum trace_event
+  {
+    TRACE_CACHE_HIT,            /* A: sector. */
+    TRACE_CACHE_MISS,           /* A: sector. */
+    TRACE_CACHE_EVICT,          /* A: evicted sector, B: dirty. */
+    TRACE_IDE_READ,             /* A: sector, B: disk. */
+    TRACE_IDE_WRITE,            /* A: sector, B: disk. */
+    TRACE_IDE_DONE,             /* A: sector, B: disk. */
+    TRACE_SYSCALL_ENTER,        /* A: syscall number, B: user stack pointer. */
+    TRACE_SYSCALL_EXIT,         /* A: syscall number, B: return value. */
+    TRACE_SCHED_SWITCH,         /* A: previous tid, B: next tid. */
+    TRACE_LOCK_WAIT,            /* A: lock address. */
+    TRACE_LOCK_ACQUIRE,         /* A: lock address, B: ticks waited. */
+    TRACE_BLOCK_READ,           /* A: sector, B: inode or TRACE_NO_INODE. */
+    TRACE_BLOCK_WRITE           /* A: sector, B: inode or TRACE_NO_INODE. */
+  };
+
+/* Inode argument of block events not caused by reading or
+   writing a particular file, such as free map updates.  Inodes
+   are otherwise identified by their sector. */
+#define TRACE_NO_INODE UINT32_MAX
+
+/* Categories being recorded.  Zero until trace_init() has set up
+   the trace buffer. */
+extern unsigned trace_mask;
+
+void trace_configure (char *categories);
+void trace_init (void);
+void trace_record (enum trace_event, uint32_t a, uint32_t b);
+int trace_dump (const char *file_name);
+
+/* Records EVENT with arguments A and B if category CAT is being
+   traced.  Costs one test and branch when it is not. */
+static inline void
+trace (enum trace_category cat, enum trace_event event,
+       uint32_t a, uint32_t b)
+{
+  if (trace_mask & cat)
+    trace_record (event, a, b);
+}
+
+/* Returns true if category CAT is being traced. */
+static inline bool
+trace_enabled (enum trace_category cat)
+{
+  return (trace_mask & cat) != 0;
+}
+
+#endif /* threads/trace.h */
@@ -0,0 +1,299 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Workqueues.
+
+   A workqueue is a list of pending work items and a set of
+   kernel threads, its workers, that take items off the list and
+   run them.  Queuing only disables interrupts and ups a
+   semaphore, so interrupt handlers may queue work; running the
+   work happens later in a worker, with interrupts on.
+
+   The "events" queue, set up by workqueue_init() and
+   workqueue_start(), is shared by everything that has no need
+   for a queue of its own.  work_schedule() queues work on it.
+   Subsystems whose work may block for a long time, such as on
+   disk I/O, should create a queue of their own with
+   workqueue_create() so that they do not hold up the rest. */
+
+/* Number of workers for the "events" queue. */
+#define EVENTS_WORKERS 1
+
+/* A workqueue. */
+struct workqueue
+  {
+    struct list_elem all_elem;  /* Element in all_workqueues. */
+    char name[16];              /* Name, for debugging and statistics. */
+    struct semaphore ready;     /* Counts items in ITEMS. */
+    struct semaphore flushed;   /* Wakes threads in workqueue_flush(). */
+
+    /* Protected by disabling interrupts. */
+    struct list items;          /* Pending work, oldest first. */
+    int active_cnt;             /* Items being run right now. */
+    int flush_cnt;              /* Threads waiting in workqueue_flush(). */
+
+    /* Statistics. */
+    unsigned queued_cnt;        /* Items queued. */
+    unsigned run_cnt;           /* Items run to completion. */
+    int64_t delay_ns;           /* Total time from queuing to start. */
+    int64_t max_delay_ns;       /* Longest time from queuing to start. */
+    int64_t max_run_ns;         /* Longest time to run one item. */
+  };
+
+/* The shared "events" queue. */
+static struct workqueue events_wq;
+
+/* All the workqueues, for workqueue_print_stats(). */
+static struct list all_workqueues;
+
+static void init_queue (struct workqueue *, const char *name);
+static void remove_queue (struct workqueue *);
+static int start_workers (struct workqueue *, int worker_cnt, int priority);
+static thread_func worker;
+
+/* Initializes work item W to run FUNC, passing AUX. */
+void
+work_init (struct work *w, work_func *func, void *aux)
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->aux = aux;
+  w->pending = false;
+}
+
+/* Queues W on the shared "events" queue, as
+   workqueue_queue().
+
+   This function may be called from an interrupt handler. */
+bool
+work_schedule (struct work *w)
+{
+  return workqueue_queue (&events_wq, w);
+}
+
+/* Initializes the workqueue system and the "events" queue.  Work
+   may be queued as soon as this has run, but none runs until
+   workqueue_start() starts the workers, so this may be called
+   before the thread scheduler is running. */
+void
+workqueue_init (void)
+{
+  list_init (&all_workqueues);
+  init_queue (&events_wq, "events");
+}
+
+/* Starts the workers for the "events" queue.  Must be called
+   after thread_start(). */
+void
+workqueue_start (void)
+{
+  if (start_workers (&events_wq, EVENTS_WORKERS, PRI_DEFAULT) == 0)
+    PANIC ("could not start \"events\" workqueue");
+}
+
+/* Creates a workqueue named NAME, served by WORKER_CNT worker
+   threads with the given PRIORITY.  Returns the new workqueue,
+   or a null pointer if memory or threads are not available.  If
+   only some of the workers could be started, the queue runs
+   with fewer.  Workqueues are never destroyed. */
+struct workqueue *
+workqueue_create (const char *name, int worker_cnt, int priority)
+{
+  struct workqueue *wq;
+
+  ASSERT (name != NULL);
+  ASSERT (worker_cnt > 0);
+  ASSERT (priority >= PRI_MIN && priority <= PRI_MAX);
+
+  wq = malloc (sizeof *wq);
+  if (wq == NULL)
+    return NULL;
+  init_queue (wq, name);
+  if (start_workers (wq, worker_cnt, priority) == 0)
+    {
+      /* No worker refers to WQ, so it is safe to free. */
+      remove_queue (wq);
+      free (wq);
+      return NULL;
+    }
+  return wq;
+}
+
+/* Queues W on WQ, to run in one of WQ's workers.  Returns true
+   if W was queued, false if it was already pending, in which
+   case it still runs only once.
+
+   This function may be called from an interrupt handler. */
+bool
+workqueue_queue (struct workqueue *wq, struct work *w)
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+  ASSERT (w->func != NULL);
+
+  old_level = intr_disable ();
+  if (!w->pending)
+    {
+      w->pending = true;
+      w->queued_ns = timer_ns ();
+      list_push_back (&wq->items, &w->elem);
+      wq->queued_cnt++;
+      queued = true;
+    }
+  if (queued)
+    sema_up (&wq->ready);
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Waits until WQ is idle, with no work pending or running, so
+   that all the work queued on WQ before the call has finished.
+   If work is queued on WQ continuously, this may wait
+   indefinitely.  Must not be called by one of WQ's own workers,
+   which would then wait on itself. */
+void
+workqueue_flush (struct workqueue *wq)
+{
+  enum intr_level old_level;
+  bool busy;
+
+  ASSERT (wq != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  busy = !list_empty (&wq->items) || wq->active_cnt > 0;
+  if (busy)
+    wq->flush_cnt++;
+  intr_set_level (old_level);
+
+  if (busy)
+    sema_down (&wq->flushed);
+}
+
+/* Prints statistics for each workqueue that has run any work. */
+void
+workqueue_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_workqueues); e != list_end (&all_workqueues);
+       e = list_next (e))
+    {
+      struct workqueue *wq = list_entry (e, struct workqueue, all_elem);
+      if (wq->run_cnt > 0)
+        printf ("Workqueue %s: %u queued, %u run, "
+                "delay avg %lld ns (max %lld), longest run %lld ns\n",
+                wq->name, wq->queued_cnt, wq->run_cnt,
+                wq->delay_ns / wq->run_cnt, wq->max_delay_ns,
+                wq->max_run_ns);
+    }
+}
+
+/* Initializes WQ as an empty queue named NAME, without workers,
+   and adds it to the list of all queues. */
+static void
+init_queue (struct workqueue *wq, const char *name)
+{
+  enum intr_level old_level;
+
+  memset (wq, 0, sizeof *wq);
+  strlcpy (wq->name, name, sizeof wq->name);
+  sema_init (&wq->ready, 0);
+  sema_init (&wq->flushed, 0);
+  list_init (&wq->items);
+
+  old_level = intr_disable ();
+  list_push_back (&all_workqueues, &wq->all_elem);
+  intr_set_level (old_level);
+}
+
+/* Removes WQ from the list of all queues. */
+static void
+remove_queue (struct workqueue *wq)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  list_remove (&wq->all_elem);
+  intr_set_level (old_level);
+}
+
+/* Starts up to WORKER_CNT workers for WQ with the given
+   PRIORITY.  Returns the number started. */
+static int
+start_workers (struct workqueue *wq, int worker_cnt, int priority)
+{
+  int i;
+
+  for (i = 0; i < worker_cnt; i++)
+    if (thread_create (wq->name, priority, worker, wq) == TID_ERROR)
+      break;
+  return i;
+}
+
+/* Worker thread for workqueue WQ_.  Runs pending work items one
+   at a time, oldest first. */
+static void
+worker (void *wq_)
+{
+  struct workqueue *wq = wq_;
+
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct work *w;
+      work_func *func;
+      void *aux;
+      int64_t start, delay, run;
+      int wake_cnt = 0;
+
+      sema_down (&wq->ready);
+
+      /* Take the oldest item.  Once it is no longer pending, it
+         may be queued again, even while it runs. */
+      old_level = intr_disable ();
+      w = list_entry (list_pop_front (&wq->items), struct work, elem);
+      w->pending = false;
+      func = w->func;
+      aux = w->aux;
+      start = timer_ns ();
+      delay = start - w->queued_ns;
+      wq->delay_ns += delay;
+      if (delay > wq->max_delay_ns)
+        wq->max_delay_ns = delay;
+      wq->active_cnt++;
+      intr_set_level (old_level);
+
+      func (aux);
+
+      /* Account for the item, and wake up any flushers if the
+         queue is now idle. */
+      run = timer_ns () - start;
+      old_level = intr_disable ();
+      wq->active_cnt--;
+      wq->run_cnt++;
+      if (run > wq->max_run_ns)
+        wq->max_run_ns = run;
+      if (list_empty (&wq->items) && wq->active_cnt == 0)
+        {
+          wake_cnt = wq->flush_cnt;
+          wq->flush_cnt = 0;
+        }
+      for (; wake_cnt > 0; wake_cnt--)
+        sema_up (&wq->flushed);
+      intr_set_level (old_level);
+    }
+}
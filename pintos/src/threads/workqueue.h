@@ -0,0 +1,43 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A function to run as deferred work, passed the AUX given to
+   work_init(). */
+typedef void work_func (void *aux);
+
+/* A unit of deferred work.
+
+   An interrupt handler that has more to do than it should do
+   with interrupts off queues a work item, which one of the
+   queue's worker threads later runs in ordinary thread context,
+   with interrupts on and free to sleep.  A work item may be
+   queued again once it has started running, but it is never on
+   a queue twice.  On a queue with more than one worker, an item
+   queued again while it runs may then run twice at once. */
+struct work
+  {
+    struct list_elem elem;      /* Element in workqueue's list. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Argument to FUNC. */
+    bool pending;               /* Queued but not yet started? */
+    int64_t queued_ns;          /* When queued, for statistics. */
+  };
+
+struct workqueue;
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_schedule (struct work *);
+
+void workqueue_init (void);
+void workqueue_start (void);
+struct workqueue *workqueue_create (const char *name, int worker_cnt,
+                                    int priority);
+bool workqueue_queue (struct workqueue *, struct work *);
+void workqueue_flush (struct workqueue *);
+void workqueue_print_stats (void);
+
+#endif /* threads/workqueue.h */
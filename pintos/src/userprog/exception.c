@@ -1,10 +1,15 @@
 #include "userprog/exception.h"
 #include <inttypes.h>
 #include <stdio.h>
+#include <user/syscall.h>
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -149,6 +154,26 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;{}
 
+#ifdef VM
+  /* Read in a page that the process has not touched before, or
+     grow its stack down to the faulting address.  Any other fault
+     on a user address, including a write to a read-only page by
+     the kernel on the process's behalf, kills the process.  A
+     fault in the kernel happens inside a system call, so the
+     process's stack pointer is the one saved on entry to it. */
+  if (is_user_vaddr (fault_addr))
+    {
+      const void *esp = user ? f->esp : thread_current ()->user_esp;
+
+      if (not_present
+          && (page_load (pg_round_down (fault_addr))
+              || (page_grow_stack (fault_addr, esp)
+                  && page_load (pg_round_down (fault_addr)))))
+        return;
+      exit (-1);
+    }
+#endif
+
   if (!is_user_vaddr((int*)fault_addr))
     exit(-1);
   else if (!pagedir_get_page(thread_current()->pagedir, (int*)fault_addr))
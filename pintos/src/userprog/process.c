@@ -15,14 +15,31 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
+/* Cache of child process records. */
+static struct kmem_cache *child_cache;
+
+/* Initializes the user process module. */
+void
+process_init (void)
+{
+  child_cache = kmem_cache_create ("child thread",
+                                   sizeof (struct child_thread), NULL);
+  if (child_cache == NULL)
+    PANIC ("child thread cache creation failed");
+}
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -40,20 +57,29 @@ process_execute (const char *file_name)
     return TID_ERROR;
   strlcpy (fn_copy, file_name, PGSIZE);
 
+  /* Name the thread after the program.  FILE_NAME may be in
+     read-only user memory, so split a copy of it. */
+  char name[16];
   char *state;
-  file_name = strtok_r((char *)file_name, " ", &state);
+  strlcpy (name, file_name, sizeof name);
+  strtok_r (name, " ", &state);
 
   struct child_thread *child;
-  child = malloc(sizeof(struct child_thread));
+  child = kmem_cache_alloc (child_cache);
+  if (child == NULL)
+    {
+      palloc_free_page (fn_copy);
+      return TID_ERROR;
+    }
   sema_init(&child->child_sema, 0);
   child->fn_copy = fn_copy;
 
   /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, child);
+  tid = thread_create (name, PRI_DEFAULT, start_process, child);
   if (tid == TID_ERROR)
     {
       palloc_free_page (fn_copy);
-      free(child);
+      kmem_cache_free (child_cache, child);
     }
   else
     {
@@ -61,7 +87,7 @@ process_execute (const char *file_name)
       child->pid = tid;
       if (!child->load_status)
         {
-          free(child);
+          kmem_cache_free (child_cache, child);
           tid = -1;
         }
       else
@@ -129,7 +155,7 @@ process_wait (tid_t child_tid UNUSED)
               sema_down(&child->child_sema);
               int status = child->exit_status;
               list_remove(el);
-              free(child);
+              kmem_cache_free (child_cache, child);
               return status;
             }
         }
@@ -145,6 +171,15 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+#ifdef VM
+  /* Free the process's pages before its page directory, which
+     still maps the ones in frames, and write back its mapped
+     files before that. */
+  page_unpin_all ();
+  mmap_destroy_all ();
+  page_table_destroy ();
+#endif
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -169,7 +204,7 @@ process_exit (void)
       struct child_thread *child = list_entry(el, struct child_thread,
                                               child_elem);
       list_remove(el);
-      free(child);
+      kmem_cache_free (child_cache, child);
     }
   if (cur->executable != NULL)
     file_close(cur->executable);
@@ -283,6 +318,10 @@ load (const char *file_name, void (**eip) (void), void **esp)
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL)
     goto done;
+#ifdef VM
+  if (!page_table_create ())
+    goto done;
+#endif
   process_activate ();
 
   char *state;
@@ -431,7 +470,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -490,6 +531,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With virtual memory, the pages are only recorded in the
+   supplemental page table here, to be read in by page_fault()
+   when first touched.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -500,6 +545,23 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifdef VM
+  while (read_bytes > 0 || zero_bytes > 0)
+    {
+      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+      size_t page_zero_bytes = PGSIZE - page_read_bytes;
+
+      if (!page_add_file (upage, page_read_bytes > 0 ? file : NULL, ofs,
+                          page_read_bytes, writable))
+        return false;
+
+      read_bytes -= page_read_bytes;
+      zero_bytes -= page_zero_bytes;
+      ofs += page_read_bytes;
+      upage += PGSIZE;
+    }
+  return true;
+#else
   file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0)
     {
@@ -535,6 +597,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       upage += PGSIZE;
     }
   return true;
+#endif
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
@@ -542,6 +605,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp)
 {
+#ifdef VM
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+
+  if (!page_add_file (upage, NULL, 0, 0, true) || !page_load (upage))
+    return false;
+  *esp = PHYS_BASE - 12;
+  return true;
+#else
   uint8_t *kpage;
   bool success = false;
 
@@ -555,8 +626,10 @@ setup_stack (void **esp)
         palloc_free_page (kpage);
     }
   return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -576,3 +649,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
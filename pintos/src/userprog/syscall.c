@@ -7,18 +7,29 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/trace.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "userprog/process.h"
 #include "userprog/pagedir.h"
 #include "devices/shutdown.h"
+#include "devices/block.h"
+#include "devices/timer.h"
 #include "filesys/inode.h"
 #include "filesys/cache.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 #define MIN_VALID_VADDR ((void *) 0x08048000)
 
 static void syscall_handler (struct intr_frame *);
 void check_valid_pointer (const void *vaddr);
+static void *user_buffer (const void *uaddr, size_t size);
+static const char *user_string (const char *ustr);
+static void copy_out (void *udst, const void *src, size_t size);
 
 /* Lock for files. */
 struct lock file_lock;
@@ -27,6 +38,7 @@ void
 syscall_init (void)
 {
   lock_init(&file_lock);
+  lock_set_name(&file_lock, "file");
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -34,8 +46,13 @@ static void
 syscall_handler (struct intr_frame *f UNUSED)
 {
 	check_valid_pointer((const void *)f->esp);
+#ifdef VM
+	thread_current()->user_esp = f->esp;
+#endif
 	uint32_t* args = ((uint32_t*) f->esp);
-	switch (*(int *)f->esp)
+	int syscall_nr = *(int *)f->esp;
+	trace(TRACE_SYSCALL, TRACE_SYSCALL_ENTER, syscall_nr, (uint32_t)f->esp);
+	switch (syscall_nr)
 		{
 			case SYS_HALT:
 				{
@@ -50,8 +67,7 @@ syscall_handler (struct intr_frame *f UNUSED)
 			case SYS_EXEC:
 				{
 					check_valid_pointer((const void *)args[1]);
-					args[1] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[1]);
+					args[1] = (int)user_string((const char *)args[1]);
 					f->eax = exec((const char *)args[1]);
 					break;
 				}
@@ -63,24 +79,21 @@ syscall_handler (struct intr_frame *f UNUSED)
 			case SYS_CREATE:
 				{
 					check_valid_pointer((const void *)args[1]);
-					args[1] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[1]);
+					args[1] = (int)user_string((const char *)args[1]);
 					f->eax = create((const char *)args[1], args[2]);
 					break;
 				}
 			case SYS_REMOVE:
 				{
 					check_valid_pointer((const void *)args[1]);
-					args[1] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[1]);
+					args[1] = (int)user_string((const char *)args[1]);
 					f->eax = remove((const char *)args[1]);
 					break;
 				}
 			case SYS_OPEN:
 				{
 					check_valid_pointer((const void *)args[1]);
-					args[1] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[1]);
+					args[1] = (int)user_string((const char *)args[1]);
 					f->eax = open((const char *)args[1]);
 					break;
 				}
@@ -93,8 +106,7 @@ syscall_handler (struct intr_frame *f UNUSED)
 				{
 					check_valid_pointer((const void *)args[2]);
 					check_valid_pointer((const void *)args[2] + args[3]);
-					args[2] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[2]);
+					args[2] = (int)user_buffer((const void *)args[2], args[3]);
 					f->eax = read(args[1], (void *)args[2], args[3]);
 					break;
 				}
@@ -102,8 +114,7 @@ syscall_handler (struct intr_frame *f UNUSED)
 				{
 					check_valid_pointer((const void *)args[2]);
 					check_valid_pointer((const void *)args[2] + args[3]);
-					args[2] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[2]);
+					args[2] = (int)user_buffer((const void *)args[2], args[3]);
 					f->eax = write(args[1], (void *)args[2], args[3]);
 					break;
 				}
@@ -127,27 +138,36 @@ syscall_handler (struct intr_frame *f UNUSED)
 					f->eax = practice(args[1]);
 					break;
 				}
+#ifdef VM
+			case SYS_MMAP:
+				{
+					f->eax = mmap(args[1], (void *)args[2]);
+					break;
+				}
+			case SYS_MUNMAP:
+				{
+					munmap(args[1]);
+					break;
+				}
+#endif
 			case SYS_CHDIR:
 				{
 					check_valid_pointer((const void *)args[1]);
-					args[1] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[1]);
+					args[1] = (int)user_string((const char *)args[1]);
 					f->eax = chdir((const char *)args[1]);
 					break;
 				}
 			case SYS_MKDIR:
 				{
 					check_valid_pointer((const void *)args[1]);
-					args[1] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[1]);
+					args[1] = (int)user_string((const char *)args[1]);
 					f->eax = mkdir((const char *)args[1]);
 					break;
 				}
 			case SYS_READDIR:
 				{
 					check_valid_pointer((const void *)args[2]);
-					args[2] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[2]);
+					args[2] = (int)user_buffer((const void *)args[2], READDIR_MAX_LEN + 1);
 					f->eax = readdir(args[1], (const char *)args[2]);
 					break;
 				}
@@ -165,8 +185,7 @@ syscall_handler (struct intr_frame *f UNUSED)
 				{
 					check_valid_pointer((const void *)args[2]);
 					check_valid_pointer((const void *)args[2] + args[3]);
-					args[2] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[2]);
+					args[2] = (int)user_buffer((const void *)args[2], args[3]);
 					f->eax = write(args[1], (void *)args[2], args[3]);
 					break;
 				}
@@ -174,12 +193,70 @@ syscall_handler (struct intr_frame *f UNUSED)
 				{
 					check_valid_pointer((const void *)args[2]);
 					check_valid_pointer((const void *)args[2] + args[3]);
-					args[2] = (int)pagedir_get_page(thread_current()->pagedir,
-													(const void *)args[2]);
+					args[2] = (int)user_buffer((const void *)args[2], args[3]);
 					f->eax = write(args[1], (void *)args[2], args[3]);
 					break;
 				}
+			case SYS_SETTICKETS:
+				{
+					f->eax = settickets(args[1]);
+					break;
+				}
+			case SYS_SCHEDSTAT:
+				{
+					struct schedstat st;
+					f->eax = schedstat(args[1], &st);
+					copy_out((void *)args[2], &st, sizeof st);
+					break;
+				}
+			case SYS_PROFILE:
+				{
+					f->eax = profile(args[1]);
+					break;
+				}
+			case SYS_TRACEDUMP:
+				{
+					if (args[1] != 0)
+						{
+							/* A null pointer asks for the serial port, so
+							   a name that does not resolve must not turn
+							   into one. */
+							check_valid_pointer((const void *)args[1]);
+							args[1] = (int)user_string((const char *)args[1]);
+							if (args[1] == 0)
+								exit(-1);
+						}
+					f->eax = tracedump((const char *)args[1]);
+					break;
+				}
+			case SYS_NANOTIME:
+				{
+					/* The result does not fit in eax, so it is stored
+					   through the pointer argument. */
+					int64_t ns = nanotime();
+					copy_out((void *)args[1], &ns, sizeof ns);
+					break;
+				}
+			case SYS_FRAGSTAT:
+				{
+					struct fragstat st;
+					f->eax = fragstat(&st);
+					copy_out((void *)args[1], &st, sizeof st);
+					break;
+				}
+			case SYS_BLOCKSTAT:
+				{
+					struct blockstat st;
+					memset(&st, 0, sizeof st);
+					f->eax = blockstat(args[1], &st);
+					copy_out((void *)args[2], &st, sizeof st);
+					break;
+				}
 		}
+#ifdef VM
+	page_unpin_all ();
+#endif
+	trace(TRACE_SYSCALL, TRACE_SYSCALL_EXIT, syscall_nr, f->eax);
 }
 
 /* Checks whether the pointer is in valid userspace. */
@@ -190,6 +267,66 @@ check_valid_pointer (const void *vaddr)
 		exit(-1);
 }
 
+/* Returns a pointer through which the kernel can access the SIZE
+   bytes of user memory at UADDR, or a null pointer if UADDR is
+   not mapped. */
+static void *
+user_buffer (const void *uaddr, size_t size UNUSED)
+{
+#ifdef VM
+	/* Pages read in on demand need not be contiguous in kernel
+	   memory, so pin the whole buffer and access it through its
+	   user address instead.  Pinning keeps the pages from being
+	   evicted while the file system, holding its locks, copies
+	   to or from them.  syscall_handler() unpins them. */
+	return page_pin (uaddr, size) ? (void *)uaddr : NULL;
+#else
+	return pagedir_get_page(thread_current()->pagedir, uaddr);
+#endif
+}
+
+/* Copies SIZE bytes from SRC to user memory at UDST, one page at
+   a time, since consecutive user pages need not be consecutive
+   in kernel memory.  Kills the process if any part of UDST is
+   not a valid, mapped user address. */
+static void
+copy_out (void *udst_, const void *src_, size_t size)
+{
+	uint8_t *udst = udst_;
+	const uint8_t *src = src_;
+
+	while (size > 0)
+		{
+			size_t chunk = PGSIZE - pg_ofs(udst);
+			void *kdst;
+
+			if (chunk > size)
+				chunk = size;
+			check_valid_pointer(udst);
+			kdst = user_buffer(udst, chunk);
+			if (kdst == NULL)
+				exit(-1);
+			memcpy(kdst, src, chunk);
+
+			udst += chunk;
+			src += chunk;
+			size -= chunk;
+		}
+}
+
+/* Returns a pointer through which the kernel can access the
+   null-terminated user string USTR, or a null pointer if USTR is
+   not mapped. */
+static const char *
+user_string (const char *ustr)
+{
+#ifdef VM
+	return page_pin_string (ustr) ? ustr : NULL;
+#else
+	return pagedir_get_page(thread_current()->pagedir, ustr);
+#endif
+}
+
 void
 halt (void)
 {
@@ -427,12 +564,104 @@ close (int fd)
 	current->file_des[fd] = 0;
 }
 
+#ifdef VM
+/* Maps the file open as FD into memory starting at ADDR.
+   Returns the new mapping's id, or MAP_FAILED if FD is not an
+   open file or the file cannot be mapped at ADDR. */
+mapid_t
+mmap (int fd, void *addr)
+{
+	if (fd < 2 || fd > 127)
+		return MAP_FAILED;
+	struct file *file = thread_current()->file_des[fd];
+	if (!file || inode_is_dir(file_get_inode (file)))
+		return MAP_FAILED;
+	return mmap_create(file, addr);
+}
+
+/* Unmaps MAPPING, writing its modified pages back to the file.
+   Kills the process if there is no such mapping. */
+void
+munmap (mapid_t mapping)
+{
+	if (!mmap_destroy(mapping))
+		exit(-1);
+}
+#endif
+
 int
 practice (int i)
 {
 	return i + 1;
 }
 
+/* Sets the stride scheduling tickets of the current process.
+   Returns 0 if successful, -1 if TICKETS is out of range. */
+int
+settickets (int tickets)
+{
+	return thread_set_tickets(tickets) ? 0 : -1;
+}
+
+/* Copies the scheduling statistics of process PID, or the
+   system-wide totals if PID is SCHEDSTAT_ALL, into *ST.
+   Returns false if there is no such process. */
+bool
+schedstat (pid_t pid, struct schedstat *st)
+{
+	return thread_get_schedstat(pid, st);
+}
+
+/* Starts the CPU profiler if ENABLE is true, returning 0 if
+   successful or -1 if it is already running or out of memory.
+   Otherwise stops the profiler and dumps its samples to the
+   serial port, returning the number of samples or -1 if it was
+   not running. */
+int
+profile (bool enable)
+{
+	if (enable)
+		return profile_start() ? 0 : -1;
+	return profile_stop();
+}
+
+/* Drains the kernel event trace into FILE, or to the serial port
+   if FILE is null.  Returns the number of events written, or -1
+   if tracing is off or FILE cannot be created. */
+int
+tracedump (const char *file)
+{
+	return trace_dump(file);
+}
+
+/* Returns the number of nanoseconds since the OS booted, measured
+   with the time stamp counter. */
+int64_t
+nanotime (void)
+{
+	return timer_ns();
+}
+
+/* Stores a fragmentation report for the file system into ST.
+   Returns true. */
+bool
+fragstat (struct fragstat *st)
+{
+	filesys_fragstat(st);
+	return true;
+}
+
+/* Stores the I/O statistics for the IDX'th block device, in
+   kernel probe order, into ST.  Returns false if there is no
+   such device. */
+bool
+blockstat (int idx, struct blockstat *st)
+{
+	if (idx < 0)
+		return false;
+	return block_get_stats(idx, st);
+}
+
 bool
 chdir (const char *dir)
 {
@@ -0,0 +1,237 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "vm/zram.h"
+
+/* Frame table.
+
+   Every frame that holds a user page is in the frame table.
+   When the user pool runs out, frame_alloc() evicts a page to
+   make room, choosing it with the clock algorithm: the clock
+   hand sweeps the table, giving each page whose accessed bit is
+   set a second chance by clearing the bit, and evicts the first
+   page found with the bit clear.  An evicted page of a
+   memory-mapped file is written back to the file if it has been
+   modified.  Any other page is compressed into the zram pool, or
+   failing that written to swap, if it has been modified or was
+   read back from either of them, and otherwise dropped, because
+   it can be read in again from its file or filled with zeros.
+
+   Lock order: a page's or shared page's lock, then frame_lock.
+   The evictor, which holds frame_lock while it looks for a
+   victim, only ever tries to acquire those locks, so it never
+   waits for one. */
+
+static struct list frames;              /* All frames. */
+static struct list_elem *hand;          /* Clock hand, or null. */
+static size_t frame_cnt;                /* Number of frames. */
+static struct lock frame_lock;          /* Protects the members above. */
+
+/* Statistics. */
+static unsigned evict_cnt;              /* Pages evicted. */
+
+static struct frame *evict (struct page *, struct shared *);
+static bool evict_page (struct page *, struct frame *);
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  list_init (&frames);
+  lock_init (&frame_lock);
+  lock_set_name (&frame_lock, "frame table");
+}
+
+/* Returns a frame to hold user page P, or shared page S if P is
+   null, evicting another page if the user pool is exhausted.
+   The frame is pinned, so that it will not be evicted before the
+   page is read into it; the caller must unpin it once the page
+   is mapped.  Returns a null pointer if no frame is available
+   and no page can be evicted. */
+struct frame *
+frame_alloc (struct page *p, struct shared *s)
+{
+  struct frame *f;
+  void *kpage;
+
+  ASSERT ((p != NULL) != (s != NULL));
+
+  kpage = palloc_get_page (PAL_USER);
+  if (kpage == NULL)
+    return evict (p, s);
+
+  f = malloc (sizeof *f);
+  if (f == NULL)
+    {
+      palloc_free_page (kpage);
+      return NULL;
+    }
+  f->kpage = kpage;
+  f->page = p;
+  f->shared = s;
+  f->pinned = true;
+
+  lock_acquire (&frame_lock);
+  list_push_back (&frames, &f->elem);
+  frame_cnt++;
+  lock_release (&frame_lock);
+  return f;
+}
+
+/* Removes F from the frame table and frees it, along with its
+   page of memory.  The caller must hold the lock of F's page. */
+void
+frame_free (struct frame *f)
+{
+  lock_acquire (&frame_lock);
+  if (hand == &f->elem)
+    hand = list_next (hand);
+  list_remove (&f->elem);
+  frame_cnt--;
+  lock_release (&frame_lock);
+
+  palloc_free_page (f->kpage);
+  free (f);
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frames: %zu in use, %u pages evicted\n", frame_cnt, evict_cnt);
+}
+
+/* Advances the clock hand and returns the frame it passes. */
+static struct frame *
+clock_next (void)
+{
+  if (hand == NULL || hand == list_end (&frames))
+    hand = list_begin (&frames);
+  else
+    hand = list_next (hand);
+  if (hand == list_end (&frames))
+    hand = list_begin (&frames);
+  return list_entry (hand, struct frame, elem);
+}
+
+/* Evicts a page with the clock algorithm and returns its frame,
+   pinned and given over to page P or shared page S.  Returns a
+   null pointer if no page can be evicted. */
+static struct frame *
+evict (struct page *p, struct shared *s)
+{
+  size_t try_cnt;
+
+  lock_acquire (&frame_lock);
+
+  /* Two sweeps clear every accessed bit, so if there is an
+     unpinned victim then a third finds it. */
+  for (try_cnt = 0; try_cnt < 3 * frame_cnt; try_cnt++)
+    {
+      struct frame *f = clock_next ();
+      struct page *victim = f->page;
+
+      if (f->pinned)
+        continue;
+
+      /* A shared page is clean, so evicting it needs no I/O and
+         can be done without releasing frame_lock. */
+      if (victim == NULL)
+        {
+          if (!share_try_evict (f->shared))
+            continue;
+          f->page = p;
+          f->shared = s;
+          f->pinned = true;
+          evict_cnt++;
+          lock_release (&frame_lock);
+          return f;
+        }
+
+      if (!lock_try_acquire (&victim->lock))
+        continue;
+
+      /* Recheck, because the page may have been pinned after we
+         looked but before we locked it. */
+      if (f->pinned)
+        ;
+      else if (pagedir_is_accessed (victim->pagedir, victim->upage))
+        pagedir_set_accessed (victim->pagedir, victim->upage, false);
+      else if (!page_needs_swap (victim) || !zram_full () || !swap_full ())
+        {
+          bool evicted;
+
+          f->pinned = true;
+          lock_release (&frame_lock);
+
+          evicted = evict_page (victim, f);
+          if (!evicted)
+            f->pinned = false;
+          lock_release (&victim->lock);
+
+          lock_acquire (&frame_lock);
+          if (!evicted)
+            {
+              /* The page did not compress or fit in the zram
+                 pool, and there is no room in swap.  Keep
+                 looking: a clean page further round the clock
+                 can still be dropped. */
+              continue;
+            }
+          f->page = p;
+          f->shared = s;
+          evict_cnt++;
+          lock_release (&frame_lock);
+          return f;
+        }
+      lock_release (&victim->lock);
+    }
+
+  lock_release (&frame_lock);
+  return NULL;
+}
+
+/* Evicts page P from frame F, writing it to swap if necessary.
+   The page is compressed into the zram pool instead if it
+   compresses well and fits.  The caller must hold P's lock.
+   Returns true if successful, false if P could not be written
+   to swap, in which case it stays in F. */
+static bool
+evict_page (struct page *p, struct frame *f)
+{
+  bool dirty;
+
+  /* Unmap the page first, so that the process faults instead of
+     modifying it while it is being written out, and then check
+     whether it was modified. */
+  pagedir_clear_page (p->pagedir, p->upage);
+  dirty = pagedir_is_dirty (p->pagedir, p->upage);
+  if (p->mmapped)
+    page_write_back (p);
+  else if (dirty || p->swap_backed)
+    {
+      p->zram_slot = zram_store (f->kpage);
+      if (p->zram_slot == ZRAM_NONE)
+        {
+          size_t slot = swap_out (f->kpage);
+          if (slot == SWAP_NONE)
+            {
+              pagedir_set_page (p->pagedir, p->upage, f->kpage,
+                                p->writable);
+              pagedir_set_dirty (p->pagedir, p->upage, dirty);
+              return false;
+            }
+          p->swap_slot = slot;
+        }
+      p->swap_backed = true;
+    }
+  p->frame = NULL;
+  return true;
+}
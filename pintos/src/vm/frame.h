@@ -0,0 +1,26 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <list.h>
+#include <stdbool.h>
+
+struct page;
+struct shared;
+
+/* A frame: a page of physical memory from the user pool that
+   holds a user page. */
+struct frame
+  {
+    struct list_elem elem;      /* Element in frame table. */
+    void *kpage;                /* Kernel virtual address. */
+    struct page *page;          /* User page held in this frame... */
+    struct shared *shared;      /* ...or shared page, if PAGE is null. */
+    bool pinned;                /* Exempt from eviction? */
+  };
+
+void frame_init (void);
+struct frame *frame_alloc (struct page *, struct shared *);
+void frame_free (struct frame *);
+void frame_print_stats (void);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,130 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* Memory-mapped files.
+
+   A mapping adds an entry to the supplemental page table for
+   each page of the file, so that pages are read in from the file
+   when first touched, just like an executable's.  Unlike an
+   executable's pages, a mapping's pages are written back to the
+   file, not to swap, when they are evicted or unmapped after
+   being modified.  The mapping keeps its own reopened copy of
+   the file, so closing the file descriptor does not affect it. */
+
+static struct mapping *lookup (int id);
+static void unmap (struct mapping *);
+
+/* Maps FILE into the current process's address space starting
+   at ADDR.  Returns the id of the new mapping, or -1 if FILE is
+   empty, ADDR is null or not page-aligned, any of the pages
+   would overlap pages already in use or the region reserved for
+   the stack, or memory is not available. */
+int
+mmap_create (struct file *file, void *addr)
+{
+  struct thread *t = thread_current ();
+  struct mapping *m;
+  off_t length;
+  size_t i;
+
+  length = file_length (file);
+  if (length == 0 || addr == NULL || pg_ofs (addr) != 0)
+    return -1;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return -1;
+  m->file = file_reopen (file);
+  if (m->file == NULL)
+    {
+      free (m);
+      return -1;
+    }
+  m->base = addr;
+  m->page_cnt = DIV_ROUND_UP (length, PGSIZE);
+
+  for (i = 0; i < m->page_cnt; i++)
+    {
+      uint8_t *upage = (uint8_t *) addr + i * PGSIZE;
+      off_t ofs = i * PGSIZE;
+      uint32_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+      if (!is_user_vaddr (upage) || page_in_stack (upage)
+          || !page_add_mmap (upage, m->file, ofs, read_bytes))
+        {
+          m->page_cnt = i;
+          unmap (m);
+          return -1;
+        }
+    }
+
+  m->id = t->next_mapid++;
+  list_push_back (&t->mappings, &m->elem);
+  return m->id;
+}
+
+/* Unmaps the current process's mapping with the given ID,
+   writing its modified pages back to the file.  Returns false if
+   there is no such mapping. */
+bool
+mmap_destroy (int id)
+{
+  struct mapping *m = lookup (id);
+
+  if (m == NULL)
+    return false;
+  list_remove (&m->elem);
+  unmap (m);
+  return true;
+}
+
+/* Unmaps all of the current process's mappings.  Must be called
+   before its supplemental page table is destroyed. */
+void
+mmap_destroy_all (void)
+{
+  struct thread *t = thread_current ();
+
+  while (!list_empty (&t->mappings))
+    {
+      struct list_elem *e = list_pop_front (&t->mappings);
+      unmap (list_entry (e, struct mapping, elem));
+    }
+}
+
+/* Returns the current process's mapping with the given ID, or a
+   null pointer if there is none. */
+static struct mapping *
+lookup (int id)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mappings); e != list_end (&t->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->id == id)
+        return m;
+    }
+  return NULL;
+}
+
+/* Removes M's pages from the supplemental page table, writing
+   back the modified ones, then closes M's file and frees M. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++)
+    page_remove ((uint8_t *) m->base + i * PGSIZE);
+  file_close (m->file);
+  free (m);
+}
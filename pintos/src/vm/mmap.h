@@ -0,0 +1,24 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct file;
+
+/* A memory-mapped file. */
+struct mapping
+  {
+    struct list_elem elem;      /* Element in thread's mappings list. */
+    int id;                     /* Mapping id returned to the process. */
+    struct file *file;          /* Mapped file, reopened for the mapping. */
+    void *base;                 /* User address of first page. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+
+int mmap_create (struct file *, void *addr);
+bool mmap_destroy (int id);
+void mmap_destroy_all (void);
+
+#endif /* vm/mmap.h */
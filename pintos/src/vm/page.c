@@ -0,0 +1,516 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "vm/zram.h"
+
+/* Supplemental page tables.
+
+   Each process has a hash table of struct page, keyed by user
+   virtual address, that records where to find each of its pages
+   that is not present in its page directory.  load() adds an
+   entry for every page of each loadable segment, instead of
+   reading the segments in up front, and page_fault() calls
+   page_load() to read a page in the first time the process
+   touches it, or after it has been evicted.  A process thus
+   reads only the parts of its executable that it uses, and
+   starts in time proportional to them instead of to its size.
+   Read-only pages of the executable are shared with every other
+   process running it, through vm/share.c.
+
+   Only the owning process adds entries to its supplemental page
+   table or looks them up, so the table itself needs no locking.
+   The evictor in vm/frame.c does change the entries of pages
+   that it evicts, so those fields are protected by each page's
+   lock. */
+
+/* Default for page_stack_limit: 8 MB. */
+#define STACK_LIMIT_DEFAULT 2048
+
+/* Maximum size of a process's stack, in pages. */
+size_t page_stack_limit = STACK_LIMIT_DEFAULT;
+
+/* How far below the stack pointer a stack access may fault.  The
+   PUSHA instruction pushes 32 bytes before it updates ESP, so it
+   can fault 32 bytes below it. */
+#define STACK_SLOP 32
+
+static struct page *add_page (void *upage, struct file *, off_t ofs,
+                               uint32_t read_bytes, bool writable);
+static bool load_locked (struct page *);
+static void destroy_page (struct page *);
+static void unpin (const void *uaddr, size_t size);
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_free;
+
+/* Creates an empty supplemental page table for the current
+   process.  Returns true if successful, false if memory is not
+   available. */
+bool
+page_table_create (void)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (t->pages == NULL);
+
+  t->pages = malloc (sizeof *t->pages);
+  if (t->pages == NULL)
+    return false;
+  if (!hash_init (t->pages, page_hash, page_less, NULL))
+    {
+      free (t->pages);
+      t->pages = NULL;
+      return false;
+    }
+  return true;
+}
+
+/* Destroys the current process's supplemental page table, if it
+   has one, freeing the frames and swap slots of its pages.  Must
+   be called before the process's page directory is destroyed. */
+void
+page_table_destroy (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->pages != NULL)
+    {
+      hash_destroy (t->pages, page_free);
+      free (t->pages);
+      t->pages = NULL;
+    }
+}
+
+/* Adds an entry to the current process's supplemental page
+   table for user page UPAGE, which is to be filled by reading
+   READ_BYTES bytes from FILE at offset OFS and zeroing the rest
+   of the page.  FILE may be null if READ_BYTES is 0.  The
+   process may write the page if WRITABLE is true; if not, and
+   FILE is not null, the page is shared with other processes
+   that map the same page of FILE, so the caller must deny
+   writes to FILE.  Returns true if successful, false if UPAGE
+   already has an entry or memory is not available. */
+bool
+page_add_file (void *upage, struct file *file, off_t ofs,
+               uint32_t read_bytes, bool writable)
+{
+  struct page *p = add_page (upage, file, ofs, read_bytes, writable);
+
+  if (p == NULL)
+    return false;
+  if (file != NULL && !writable)
+    {
+      p->shared = share_get (file, ofs, read_bytes);
+      if (p->shared == NULL)
+        {
+          hash_delete (thread_current ()->pages, &p->hash_elem);
+          free (p);
+          return false;
+        }
+    }
+  return true;
+}
+
+/* Adds an entry to the current process's supplemental page
+   table for user page UPAGE, which maps READ_BYTES bytes of FILE
+   starting at offset OFS, followed by zeros.  The page is
+   writable, and its modifications are written back to FILE.
+   Returns true if successful, false if UPAGE already has an
+   entry or memory is not available. */
+bool
+page_add_mmap (void *upage, struct file *file, off_t ofs,
+               uint32_t read_bytes)
+{
+  struct page *p = add_page (upage, file, ofs, read_bytes, true);
+
+  if (p == NULL)
+    return false;
+  p->mmapped = true;
+  return true;
+}
+
+/* Removes the current process's supplemental page table entry
+   for UPAGE, which must exist, unmapping the page and freeing
+   its frame or swap slot.  A modified page of a memory-mapped
+   file is first written back to the file. */
+void
+page_remove (void *upage)
+{
+  struct page *p = page_lookup (upage);
+
+  ASSERT (p != NULL);
+
+  hash_delete (thread_current ()->pages, &p->hash_elem);
+  destroy_page (p);
+}
+
+/* Returns the current process's supplemental page table entry
+   for the page that contains UPAGE, or a null pointer if there
+   is none. */
+struct page *
+page_lookup (const void *upage)
+{
+  struct thread *t = thread_current ();
+  struct page p;
+  struct hash_elem *e;
+
+  if (t->pages == NULL)
+    return NULL;
+  p.upage = pg_round_down (upage);
+  e = hash_find (t->pages, &p.hash_elem);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Brings the page that contains user address UPAGE into memory,
+   from the current process's supplemental page table, and maps
+   it.  Returns true if successful, false if UPAGE has no entry
+   or could not be read in. */
+bool
+page_load (void *upage)
+{
+  struct page *p = page_lookup (upage);
+  bool success = true;
+
+  if (p == NULL)
+    return false;
+  if (p->shared != NULL)
+    return share_map (p, false);
+
+  lock_acquire (&p->lock);
+  if (p->frame == NULL)
+    {
+      success = load_locked (p);
+      if (success)
+        p->frame->pinned = false;
+    }
+  lock_release (&p->lock);
+  return success;
+}
+
+/* Grows the current process's stack, if user address UADDR
+   looks like an access to the stack given user stack pointer
+   ESP, by adding an all-zero page for UADDR to the supplemental
+   page table.  The page is read in on demand like any other.
+   Returns true if a page was added, false if UADDR is not a
+   stack access, already has a page, or memory is not
+   available. */
+bool
+page_grow_stack (const void *uaddr, const void *esp)
+{
+  if (!page_in_stack (uaddr)
+      || (const uint8_t *) uaddr < (const uint8_t *) esp - STACK_SLOP)
+    return false;
+  return page_add_file (pg_round_down (uaddr), NULL, 0, 0, true);
+}
+
+/* Returns true if user address UADDR is in the region reserved
+   for the stack, the top page_stack_limit pages of user virtual
+   memory. */
+bool
+page_in_stack (const void *uaddr)
+{
+  return (is_user_vaddr (uaddr)
+          && (size_t) ((const uint8_t *) PHYS_BASE
+                       - (const uint8_t *) uaddr)
+             <= page_stack_limit * PGSIZE);
+}
+
+/* Returns true if evicting P would require writing it to swap,
+   because it has been modified or has no other backing store.
+   P must be in a frame. */
+bool
+page_needs_swap (struct page *p)
+{
+  if (p->mmapped)
+    return false;
+  return p->swap_backed || pagedir_is_dirty (p->pagedir, p->upage);
+}
+
+/* Writes page P, which must belong to a memory-mapped file and
+   be in a frame, back to its file if it has been modified.  P's
+   lock must be held. */
+void
+page_write_back (struct page *p)
+{
+  ASSERT (p->mmapped);
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->lock));
+
+  if (pagedir_is_dirty (p->pagedir, p->upage))
+    {
+      file_write_at (p->file, p->frame->kpage, p->read_bytes, p->ofs);
+      pagedir_set_dirty (p->pagedir, p->upage, false);
+    }
+}
+
+/* Brings every page of user memory in the SIZE bytes starting at
+   UADDR into memory and pins it there, so that the kernel can
+   access the memory while holding locks that a page fault would
+   need, such as those inside the file system.  At least the
+   page that contains UADDR is pinned, even if SIZE is 0.  The
+   pages stay pinned until page_unpin_all().  Grows the stack if
+   necessary, as if the process had touched the memory itself.
+   Returns false, pinning nothing, if some page is neither
+   present nor loadable. */
+bool
+page_pin (const void *uaddr, size_t size)
+{
+  struct thread *t = thread_current ();
+  const uint8_t *first = pg_round_down (uaddr);
+  const uint8_t *last = (const uint8_t *) uaddr + (size > 0 ? size - 1 : 0);
+  const uint8_t *upage;
+
+  ASSERT (t->pinned_size == 0);
+
+  for (upage = first; upage <= last; upage += PGSIZE)
+    {
+      struct page *p = is_user_vaddr (upage) ? page_lookup (upage) : NULL;
+      bool success;
+
+      /* The system call's buffer may be on a part of the stack
+         that the process has not touched yet. */
+      if (p == NULL
+          && page_grow_stack (upage > first ? (const void *) upage : uaddr,
+                              t->user_esp))
+        p = page_lookup (upage);
+      success = p != NULL;
+
+      if (success && p->shared != NULL)
+        success = share_map (p, true);
+      else if (success)
+        {
+          lock_acquire (&p->lock);
+          if (p->frame != NULL)
+            p->frame->pinned = true;
+          else
+            success = load_locked (p);
+          lock_release (&p->lock);
+        }
+      if (!success)
+        {
+          unpin (first, upage - first);
+          return false;
+        }
+    }
+
+  t->pinned_uaddr = first;
+  t->pinned_size = last - first + 1;
+  return true;
+}
+
+/* Pins every page of the null-terminated user string USTR, as
+   page_pin().  Returns false, pinning nothing, if some page is
+   neither present nor loadable. */
+bool
+page_pin_string (const char *ustr)
+{
+  const char *end = ustr;
+
+  for (;;)
+    {
+      const char *page_end = (const char *) pg_round_down (end) + PGSIZE;
+
+      if (!page_pin (end, 1))
+        {
+          if (end != ustr)
+            unpin (ustr, end - ustr);
+          thread_current ()->pinned_size = 0;
+          return false;
+        }
+      thread_current ()->pinned_size = 0;
+      for (; end < page_end; end++)
+        if (*end == '\0')
+          {
+            thread_current ()->pinned_uaddr = ustr;
+            thread_current ()->pinned_size = end - ustr + 1;
+            return true;
+          }
+    }
+}
+
+/* Unpins the user memory pinned by page_pin() or
+   page_pin_string(), if any. */
+void
+page_unpin_all (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->pinned_size > 0)
+    {
+      unpin (t->pinned_uaddr, t->pinned_size);
+      t->pinned_size = 0;
+    }
+}
+
+/* Adds and returns an entry for UPAGE to the current process's
+   supplemental page table, as described for page_add_file().
+   Returns a null pointer if UPAGE already has an entry or memory
+   is not available. */
+static struct page *
+add_page (void *upage, struct file *file, off_t ofs,
+          uint32_t read_bytes, bool writable)
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (read_bytes <= PGSIZE);
+  ASSERT (file != NULL || read_bytes == 0);
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->pagedir = t->pagedir;
+  p->writable = writable;
+  lock_init (&p->lock);
+  p->frame = NULL;
+  p->swap_slot = SWAP_NONE;
+  p->zram_slot = ZRAM_NONE;
+  p->swap_backed = false;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  p->mmapped = false;
+  p->shared = NULL;
+  if (hash_insert (t->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Reads page P into a new frame and maps it, leaving the frame
+   pinned.  P's lock must be held and P must not be in a frame.
+   Returns true if successful, false if no frame is available or
+   P could not be read. */
+static bool
+load_locked (struct page *p)
+{
+  struct frame *f;
+
+  ASSERT (lock_held_by_current_thread (&p->lock));
+  ASSERT (p->frame == NULL);
+
+  f = frame_alloc (p, NULL);
+  if (f == NULL)
+    return false;
+
+  if (p->zram_slot != ZRAM_NONE)
+    {
+      zram_load (p->zram_slot, f->kpage);
+      p->zram_slot = ZRAM_NONE;
+    }
+  else if (p->swap_slot != SWAP_NONE)
+    {
+      swap_in (p->swap_slot, f->kpage);
+      p->swap_slot = SWAP_NONE;
+    }
+  else
+    {
+      if (p->read_bytes > 0
+          && file_read_at (p->file, f->kpage, p->read_bytes, p->ofs)
+             != (off_t) p->read_bytes)
+        {
+          frame_free (f);
+          return false;
+        }
+      memset ((uint8_t *) f->kpage + p->read_bytes, 0,
+              PGSIZE - p->read_bytes);
+    }
+
+  if (!pagedir_set_page (p->pagedir, p->upage, f->kpage, p->writable))
+    {
+      frame_free (f);
+      return false;
+    }
+  p->frame = f;
+  return true;
+}
+
+/* Unpins each page in the SIZE bytes of user memory starting at
+   UADDR. */
+static void
+unpin (const void *uaddr, size_t size)
+{
+  const uint8_t *upage = pg_round_down (uaddr);
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+
+  for (; upage < end; upage += PGSIZE)
+    {
+      struct page *p = page_lookup (upage);
+      if (p != NULL && p->shared != NULL)
+        share_unpin (p);
+      else if (p != NULL)
+        {
+          lock_acquire (&p->lock);
+          if (p->frame != NULL)
+            p->frame->pinned = false;
+          lock_release (&p->lock);
+        }
+    }
+}
+
+/* Returns a hash of the address of page P. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return hash_bytes (&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+  return a->upage < b->upage;
+}
+
+/* Frees supplemental page table entry E. */
+static void
+page_free (struct hash_elem *e, void *aux UNUSED)
+{
+  destroy_page (hash_entry (e, struct page, hash_elem));
+}
+
+/* Unmaps page P and frees it, along with its frame or swap slot,
+   writing it back first if it is a modified page of a
+   memory-mapped file.  P must no longer be in a supplemental
+   page table. */
+static void
+destroy_page (struct page *p)
+{
+  if (p->shared != NULL)
+    {
+      share_put (p);
+      free (p);
+      return;
+    }
+
+  lock_acquire (&p->lock);
+  if (p->frame != NULL)
+    {
+      if (p->mmapped)
+        page_write_back (p);
+      pagedir_clear_page (p->pagedir, p->upage);
+      frame_free (p->frame);
+    }
+  if (p->zram_slot != ZRAM_NONE)
+    zram_free (p->zram_slot);
+  if (p->swap_slot != SWAP_NONE)
+    swap_free (p->swap_slot);
+  lock_release (&p->lock);
+  free (p);
+}
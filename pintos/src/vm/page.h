@@ -0,0 +1,80 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct file;
+
+/* A page of a process's virtual address space, as recorded in
+   its supplemental page table.
+
+   The supplemental page table says where the contents of each
+   user page are when they are not in memory, so that a page
+   fault can bring them in.  Every page of an executable's
+   segments has an entry from the time the process is loaded,
+   but is read in only when first touched. */
+struct page
+  {
+    struct hash_elem hash_elem; /* Element in supplemental page table. */
+    void *upage;                /* User virtual address. */
+    uint32_t *pagedir;          /* Page directory that maps UPAGE. */
+    bool writable;              /* May the process write the page? */
+
+    /* Protects the members below.  Held while the page is read
+       in, evicted, pinned, or unpinned. */
+    struct lock lock;
+    struct frame *frame;        /* Frame holding the page, or null. */
+    size_t swap_slot;           /* Swap slot holding the page, or
+                                   SWAP_NONE. */
+    size_t zram_slot;           /* Compressed copy of the page, or
+                                   ZRAM_NONE. */
+    bool swap_backed;           /* Evict to zram or swap even if
+                                   clean? */
+
+    /* Where the page's data comes from if it is in neither a
+       frame nor swap.  The first READ_BYTES bytes are read from
+       FILE at offset OFS and the rest of the page is zeroed.
+       FILE is null for an all-zero page.  If MMAPPED is true,
+       the page belongs to a memory-mapped file, and modifications
+       are written back to FILE instead of to swap. */
+    struct file *file;          /* File to read from, or null. */
+    off_t ofs;                  /* Offset in FILE. */
+    uint32_t read_bytes;        /* Bytes to read from FILE. */
+    bool mmapped;               /* Write back to FILE? */
+
+    /* A read-only page of an executable is shared with other
+       processes running the same executable, through SHARED,
+       instead of having a frame or swap slot of its own. */
+    struct shared *shared;      /* Shared page, or null. */
+    struct list_elem shared_elem; /* Element in SHARED's mappers. */
+  };
+
+/* Maximum size of a process's stack, in pages. */
+extern size_t page_stack_limit;
+
+bool page_table_create (void);
+void page_table_destroy (void);
+
+bool page_add_file (void *upage, struct file *, off_t ofs,
+                    uint32_t read_bytes, bool writable);
+bool page_add_mmap (void *upage, struct file *, off_t ofs,
+                    uint32_t read_bytes);
+void page_remove (void *upage);
+struct page *page_lookup (const void *upage);
+bool page_load (void *upage);
+bool page_grow_stack (const void *uaddr, const void *esp);
+bool page_in_stack (const void *uaddr);
+bool page_needs_swap (struct page *);
+void page_write_back (struct page *);
+
+bool page_pin (const void *uaddr, size_t size);
+bool page_pin_string (const char *ustr);
+void page_unpin_all (void);
+
+#endif /* vm/page.h */
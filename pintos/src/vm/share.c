@@ -0,0 +1,267 @@
+#include "vm/share.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+
+/* Shared executable pages.
+
+   The read-only pages of an executable, its code and constant
+   data, are the same in every process that runs it, so they are
+   read in once and the same frame is mapped into each process.
+   The shared page table holds one struct shared per page, keyed
+   by the executable's inode and the page's offset in it, for as
+   long as some process has the page in its supplemental page
+   table.  Each such process keeps the executable open with
+   writes denied, so the page's contents cannot change while it
+   is shared.
+
+   Eviction unmaps a shared frame from every process at once.
+   The pages are never modified, so they are simply dropped.
+
+   Lock order: a shared page's lock, then share_lock or
+   frame_lock.  The evictor holds frame_lock and only tries to
+   acquire shared pages' locks, so it never waits for one. */
+
+/* Shared page table. */
+static struct hash shared_pages;
+static struct lock share_lock;  /* Protects shared_pages, ref_cnt. */
+
+/* Statistics. */
+static unsigned read_cnt;       /* Pages read in. */
+static unsigned hit_cnt;        /* Mappings of already-read pages. */
+
+static hash_hash_func shared_hash;
+static hash_less_func shared_less;
+
+/* Initializes the shared page table. */
+void
+share_init (void)
+{
+  hash_init (&shared_pages, shared_hash, shared_less, NULL);
+  lock_init (&share_lock);
+  lock_set_name (&share_lock, "shared pages");
+}
+
+/* Returns the shared page for the page of executable FILE at
+   offset OFS, whose first READ_BYTES bytes come from FILE and
+   the rest are zero, creating it if necessary, and takes a
+   reference to it.  The caller must deny writes to FILE for as
+   long as it holds the reference.  Returns a null pointer if
+   memory is not available. */
+struct shared *
+share_get (struct file *file, off_t ofs, uint32_t read_bytes)
+{
+  struct shared key, *s;
+  struct hash_elem *e;
+
+  key.inode = file_get_inode (file);
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+
+  lock_acquire (&share_lock);
+  e = hash_find (&shared_pages, &key.hash_elem);
+  if (e != NULL)
+    s = hash_entry (e, struct shared, hash_elem);
+  else
+    {
+      s = malloc (sizeof *s);
+      if (s != NULL)
+        {
+          *s = key;
+          s->ref_cnt = 0;
+          lock_init (&s->lock);
+          s->frame = NULL;
+          list_init (&s->mappers);
+          s->pin_cnt = 0;
+          hash_insert (&shared_pages, &s->hash_elem);
+        }
+    }
+  if (s != NULL)
+    s->ref_cnt++;
+  lock_release (&share_lock);
+  return s;
+}
+
+/* Unmaps page P's shared page from P's process, if it is mapped,
+   and drops P's reference to it.  The shared page and its frame
+   are freed when the last reference is dropped. */
+void
+share_put (struct page *p)
+{
+  struct shared *s = p->shared;
+  bool last;
+
+  lock_acquire (&s->lock);
+  if (pagedir_get_page (p->pagedir, p->upage) != NULL)
+    {
+      pagedir_clear_page (p->pagedir, p->upage);
+      list_remove (&p->shared_elem);
+    }
+  lock_release (&s->lock);
+
+  lock_acquire (&share_lock);
+  last = --s->ref_cnt == 0;
+  if (last)
+    hash_delete (&shared_pages, &s->hash_elem);
+  lock_release (&share_lock);
+
+  if (last)
+    {
+      /* No process refers to S any more, but the evictor still
+         may, through its frame, until the frame is freed. */
+      lock_acquire (&s->lock);
+      if (s->frame != NULL)
+        frame_free (s->frame);
+      lock_release (&s->lock);
+      free (s);
+    }
+}
+
+/* Maps page P's shared page into P's process, reading it into a
+   frame first if no process has it in memory.  If PIN is true,
+   also pins the frame, until share_unpin().  Returns true if
+   successful, false if no frame is available or the page could
+   not be read. */
+bool
+share_map (struct page *p, bool pin)
+{
+  struct shared *s = p->shared;
+  bool success = true;
+
+  lock_acquire (&s->lock);
+  if (s->frame == NULL)
+    {
+      struct frame *f = frame_alloc (NULL, s);
+
+      if (f == NULL)
+        success = false;
+      else if (file_read_at (p->file, f->kpage, s->read_bytes, s->ofs)
+               != (off_t) s->read_bytes)
+        {
+          frame_free (f);
+          success = false;
+        }
+      else
+        {
+          memset ((uint8_t *) f->kpage + s->read_bytes, 0,
+                  PGSIZE - s->read_bytes);
+          s->frame = f;
+          f->pinned = false;
+          lock_acquire (&share_lock);
+          read_cnt++;
+          lock_release (&share_lock);
+        }
+    }
+  else
+    {
+      lock_acquire (&share_lock);
+      hit_cnt++;
+      lock_release (&share_lock);
+    }
+
+  if (success && pagedir_get_page (p->pagedir, p->upage) == NULL)
+    {
+      success = pagedir_set_page (p->pagedir, p->upage, s->frame->kpage,
+                                  false);
+      if (success)
+        list_push_back (&s->mappers, &p->shared_elem);
+    }
+  if (success && pin)
+    s->pin_cnt++;
+  lock_release (&s->lock);
+  return success;
+}
+
+/* Drops a pin taken on page P's shared page by share_map(). */
+void
+share_unpin (struct page *p)
+{
+  struct shared *s = p->shared;
+
+  lock_acquire (&s->lock);
+  ASSERT (s->pin_cnt > 0);
+  s->pin_cnt--;
+  lock_release (&s->lock);
+}
+
+/* Called by the evictor, with the frame table locked, to try to
+   evict shared page S from its frame.  Gives S a second chance,
+   clearing the accessed bits, if any process has accessed it
+   recently.  Returns true if S was evicted, in which case it no
+   longer has a frame; false if it is in use, pinned, or was
+   recently accessed. */
+bool
+share_try_evict (struct shared *s)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  if (!lock_try_acquire (&s->lock))
+    return false;
+  if (s->pin_cnt > 0 || s->frame == NULL)
+    {
+      lock_release (&s->lock);
+      return false;
+    }
+
+  for (e = list_begin (&s->mappers); e != list_end (&s->mappers);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, shared_elem);
+      if (pagedir_is_accessed (p->pagedir, p->upage))
+        {
+          pagedir_set_accessed (p->pagedir, p->upage, false);
+          accessed = true;
+        }
+    }
+
+  if (!accessed)
+    {
+      while (!list_empty (&s->mappers))
+        {
+          struct page *p = list_entry (list_pop_front (&s->mappers),
+                                       struct page, shared_elem);
+          pagedir_clear_page (p->pagedir, p->upage);
+        }
+      s->frame = NULL;
+    }
+  lock_release (&s->lock);
+  return !accessed;
+}
+
+/* Prints shared page statistics. */
+void
+share_print_stats (void)
+{
+  printf ("Shared pages: %zu in use, %u read in, %u mapped without I/O\n",
+          hash_size (&shared_pages), read_cnt, hit_cnt);
+}
+
+/* Returns a hash of shared page E's inode and offset. */
+static unsigned
+shared_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct shared *s = hash_entry (e, struct shared, hash_elem);
+  return hash_bytes (&s->inode, sizeof s->inode) ^ hash_int (s->ofs);
+}
+
+/* Returns true if shared page A precedes shared page B. */
+static bool
+shared_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct shared *a = hash_entry (a_, struct shared, hash_elem);
+  const struct shared *b = hash_entry (b_, struct shared, hash_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  return a->read_bytes < b->read_bytes;
+}
@@ -0,0 +1,44 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct file;
+struct inode;
+struct page;
+
+/* A read-only page of an executable, shared by every process
+   running the executable.
+
+   Each process still has a struct page for its own mapping of
+   the page, whose SHARED member points here.  The frame holding
+   the page, if any, is mapped into the page directory of each
+   process in MAPPERS. */
+struct shared
+  {
+    struct hash_elem hash_elem; /* Element in shared page table. */
+    struct inode *inode;        /* Executable's inode. */
+    off_t ofs;                  /* Offset in executable. */
+    uint32_t read_bytes;        /* Bytes to read; the rest are zero. */
+    int ref_cnt;                /* Number of struct pages using this. */
+
+    struct lock lock;           /* Protects the members below. */
+    struct frame *frame;        /* Frame holding the page, or null. */
+    struct list mappers;        /* Pages that map FRAME. */
+    int pin_cnt;                /* Number of pins on FRAME. */
+  };
+
+void share_init (void);
+struct shared *share_get (struct file *, off_t ofs, uint32_t read_bytes);
+void share_put (struct page *);
+bool share_map (struct page *, bool pin);
+void share_unpin (struct page *);
+bool share_try_evict (struct shared *);
+void share_print_stats (void);
+
+#endif /* vm/share.h */
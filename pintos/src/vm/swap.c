@@ -0,0 +1,117 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   The BLOCK_SWAP device is divided into page-sized slots, each
+   SECTORS_PER_SLOT sectors long.  A bitmap records which slots
+   hold a page.  Without a swap device every slot is taken, so
+   only pages that can be read back from a file can be
+   evicted. */
+
+/* Sectors per swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block *swap_device;       /* Swap device, or null. */
+static struct bitmap *used_slots;       /* Slots in use. */
+static struct lock swap_lock;           /* Protects used_slots. */
+
+/* Statistics. */
+static unsigned out_cnt;                /* Pages written to swap. */
+static unsigned in_cnt;                 /* Pages read from swap. */
+
+/* Initializes swap space on the BLOCK_SWAP device, if there is
+   one. */
+void
+swap_init (void)
+{
+  size_t slot_cnt = 0;
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device != NULL)
+    slot_cnt = block_size (swap_device) / SECTORS_PER_SLOT;
+  used_slots = bitmap_create (slot_cnt);
+  if (used_slots == NULL)
+    PANIC ("swap bitmap creation failed");
+  lock_init (&swap_lock);
+  lock_set_name (&swap_lock, "swap");
+}
+
+/* Returns true if there is no free swap slot, which may of
+   course change before the caller acts on it. */
+bool
+swap_full (void)
+{
+  bool full;
+
+  lock_acquire (&swap_lock);
+  full = bitmap_all (used_slots, 0, bitmap_size (used_slots));
+  lock_release (&swap_lock);
+  return full;
+}
+
+/* Writes the page at KPAGE to a free swap slot and returns the
+   slot, or SWAP_NONE if swap space is full. */
+size_t
+swap_out (const void *kpage)
+{
+  size_t slot;
+  int i;
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (used_slots, 0, 1, false);
+  if (slot != BITMAP_ERROR)
+    out_cnt++;
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_NONE;
+
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    block_write (swap_device, slot * SECTORS_PER_SLOT + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  return slot;
+}
+
+/* Reads the page in swap SLOT into KPAGE and frees SLOT. */
+void
+swap_in (size_t slot, void *kpage)
+{
+  int i;
+
+  ASSERT (slot != SWAP_NONE);
+
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    block_read (swap_device, slot * SECTORS_PER_SLOT + i,
+                (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&swap_lock);
+  in_cnt++;
+  lock_release (&swap_lock);
+  swap_free (slot);
+}
+
+/* Frees swap SLOT without reading it. */
+void
+swap_free (size_t slot)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (used_slots, slot));
+  bitmap_reset (used_slots, slot);
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  if (swap_device != NULL)
+    printf ("Swap: %u pages written, %u pages read, %zu of %zu slots used\n",
+            out_cnt, in_cnt, bitmap_count (used_slots, 0,
+                                           bitmap_size (used_slots), true),
+            bitmap_size (used_slots));
+}
@@ -0,0 +1,318 @@
+#include "vm/zram.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed page pool.
+
+   Before the evictor writes a page to swap, it tries to compress
+   it into this pool, which is carved out of the kernel pool at
+   boot.  Reading a compressed page back in takes a few
+   microseconds of decompression instead of a disk read, so a
+   workload that needs somewhat more memory than there is keeps
+   running at close to memory speed.  Pages that do not compress
+   well go to swap as before.
+
+   The pool is divided into CHUNK_SIZE-byte chunks.  A compressed
+   page occupies a run of consecutive chunks, starting with a
+   struct zram_header that records the compressed length.  The
+   handle for a compressed page is the index of its first
+   chunk.
+
+   Pages are compressed with a simple LZ77 codec, in the style of
+   LZRW1: fast and with a small fixed amount of state, rather
+   than giving the best possible ratio. */
+
+/* Default for zram_pages. */
+#define ZRAM_PAGES_DEFAULT 64
+
+/* Size of the compressed page pool, in pages of the kernel pool.
+   0 disables compression. */
+size_t zram_pages = ZRAM_PAGES_DEFAULT;
+
+/* Size of an allocation unit in the pool. */
+#define CHUNK_SIZE 64
+
+/* Pages that do not compress to at most this size are not worth
+   keeping in the pool. */
+#define MAX_STORED (PGSIZE * 3 / 4)
+
+/* Header at the start of each compressed page. */
+struct zram_header
+  {
+    uint16_t length;            /* Compressed length in bytes. */
+  };
+
+static uint8_t *pool;           /* Start of pool, or null. */
+static struct bitmap *used_chunks; /* Chunks in use. */
+static struct lock zram_lock;   /* Protects the pool and buffers. */
+
+/* Compression output buffer. */
+static uint8_t buffer[MAX_STORED];
+
+/* Statistics. */
+static unsigned store_cnt;      /* Pages compressed and stored. */
+static unsigned reject_cnt;     /* Pages that did not compress. */
+static unsigned load_cnt;       /* Pages decompressed. */
+static unsigned long long stored_bytes; /* Compressed bytes stored. */
+
+static size_t lz_compress (const uint8_t *src, uint8_t *dst,
+                           size_t dst_size);
+static void lz_decompress (const uint8_t *src, uint8_t *dst);
+
+/* Allocates the compressed page pool, if it is enabled. */
+void
+zram_init (void)
+{
+  lock_init (&zram_lock);
+  lock_set_name (&zram_lock, "zram");
+
+  if (zram_pages > 0)
+    {
+      pool = palloc_get_multiple (0, zram_pages);
+      if (pool == NULL)
+        printf ("zram: could not allocate %zu pages, compression "
+                "disabled\n", zram_pages);
+    }
+  used_chunks = bitmap_create (pool != NULL
+                               ? zram_pages * PGSIZE / CHUNK_SIZE : 0);
+  if (used_chunks == NULL)
+    PANIC ("zram bitmap creation failed");
+}
+
+/* Returns true if the pool has no free chunk, so that no page
+   can be stored in it. */
+bool
+zram_full (void)
+{
+  bool full;
+
+  lock_acquire (&zram_lock);
+  full = bitmap_all (used_chunks, 0, bitmap_size (used_chunks));
+  lock_release (&zram_lock);
+  return full;
+}
+
+/* Compresses the page at KPAGE into the pool.  Returns a handle
+   for it, or ZRAM_NONE if it does not compress well or there is
+   no room. */
+size_t
+zram_store (const void *kpage)
+{
+  size_t length, chunk_cnt, handle = ZRAM_NONE;
+
+  lock_acquire (&zram_lock);
+  if (!bitmap_all (used_chunks, 0, bitmap_size (used_chunks)))
+    {
+      length = lz_compress (kpage, buffer,
+                            sizeof buffer - sizeof (struct zram_header));
+      if (length == 0)
+        reject_cnt++;
+      else
+        {
+          chunk_cnt = DIV_ROUND_UP (sizeof (struct zram_header) + length,
+                                    CHUNK_SIZE);
+          handle = bitmap_scan_and_flip (used_chunks, 0, chunk_cnt, false);
+          if (handle != BITMAP_ERROR)
+            {
+              uint8_t *p = pool + handle * CHUNK_SIZE;
+              struct zram_header h;
+
+              h.length = length;
+              memcpy (p, &h, sizeof h);
+              memcpy (p + sizeof h, buffer, length);
+              store_cnt++;
+              stored_bytes += length;
+            }
+          else
+            handle = ZRAM_NONE;
+        }
+    }
+  lock_release (&zram_lock);
+  return handle;
+}
+
+/* Decompresses the page with the given HANDLE into KPAGE and
+   frees it from the pool. */
+void
+zram_load (size_t handle, void *kpage)
+{
+  ASSERT (handle != ZRAM_NONE);
+
+  lock_acquire (&zram_lock);
+  lz_decompress (pool + handle * CHUNK_SIZE + sizeof (struct zram_header),
+                 kpage);
+  load_cnt++;
+  lock_release (&zram_lock);
+  zram_free (handle);
+}
+
+/* Frees the compressed page with the given HANDLE without
+   decompressing it. */
+void
+zram_free (size_t handle)
+{
+  struct zram_header h;
+
+  lock_acquire (&zram_lock);
+  memcpy (&h, pool + handle * CHUNK_SIZE, sizeof h);
+  ASSERT (bitmap_all (used_chunks, handle,
+                      DIV_ROUND_UP (sizeof h + h.length, CHUNK_SIZE)));
+  bitmap_set_multiple (used_chunks, handle,
+                       DIV_ROUND_UP (sizeof h + h.length, CHUNK_SIZE), false);
+  lock_release (&zram_lock);
+}
+
+/* Prints compressed page pool statistics. */
+void
+zram_print_stats (void)
+{
+  if (pool == NULL)
+    return;
+  printf ("Zram: %u pages stored (avg %llu bytes), %u not compressible, "
+          "%u loaded, %zu of %zu chunks used\n",
+          store_cnt, store_cnt > 0 ? stored_bytes / store_cnt : 0,
+          reject_cnt, load_cnt,
+          bitmap_count (used_chunks, 0, bitmap_size (used_chunks), true),
+          bitmap_size (used_chunks));
+}
+
+/* LZ77 codec.
+
+   The compressed data is a sequence of groups, each a control
+   byte followed by up to 8 items, one per bit of the control
+   byte from least to most significant.  A 0 bit is a literal
+   byte, copied as is.  A 1 bit is a match: a 16-bit little-endian
+   word whose top 12 bits are the distance back to the start of
+   the match, 1 to LZ_MAX_OFFSET, and whose low 4 bits are its
+   length less LZ_MIN_MATCH.  A length field of 15 is followed by
+   a byte that is added to it, so that long runs, such as of
+   zeros, stay short. */
+
+#define LZ_MIN_MATCH 3                  /* Shortest match. */
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 15 + 255) /* Longest match. */
+#define LZ_MAX_OFFSET 4095              /* Farthest match. */
+#define LZ_HASH_BITS 12                 /* Size of hash table. */
+
+/* Most recent position + 1 of each hash of 3 bytes, or 0. */
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+/* Returns a hash of the 3 bytes at P. */
+static inline unsigned
+lz_hash (const uint8_t *p)
+{
+  uint32_t x = p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16);
+  return (x * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compresses the PGSIZE bytes at SRC into DST, which has room
+   for DST_SIZE bytes.  Returns the compressed length, or 0 if it
+   would exceed DST_SIZE. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_size)
+{
+  size_t in = 0, out = 0;
+  uint8_t *ctrl = NULL;
+  int bit = 8;
+
+  memset (lz_table, 0, sizeof lz_table);
+  while (in < PGSIZE)
+    {
+      size_t len = 0, offset = 0;
+
+      if (bit == 8)
+        {
+          if (out >= dst_size)
+            return 0;
+          ctrl = &dst[out++];
+          *ctrl = 0;
+          bit = 0;
+        }
+
+      /* Find the most recent earlier occurrence of the next 3
+         bytes, if any, and measure how long the match is. */
+      if (in + LZ_MIN_MATCH <= PGSIZE)
+        {
+          unsigned h = lz_hash (src + in);
+          size_t cand = lz_table[h];
+
+          lz_table[h] = in + 1;
+          if (cand != 0 && in - (cand - 1) <= LZ_MAX_OFFSET)
+            {
+              cand--;
+              offset = in - cand;
+              while (in + len < PGSIZE && len < LZ_MAX_MATCH
+                     && src[cand + len] == src[in + len])
+                len++;
+            }
+        }
+
+      if (len >= LZ_MIN_MATCH)
+        {
+          size_t extra = len - LZ_MIN_MATCH;
+          uint16_t word = (offset << 4) | (extra < 15 ? extra : 15);
+
+          if (out + 3 > dst_size)
+            return 0;
+          *ctrl |= 1 << bit;
+          dst[out++] = word & 0xff;
+          dst[out++] = word >> 8;
+          if (extra >= 15)
+            dst[out++] = extra - 15;
+          in += len;
+        }
+      else
+        {
+          if (out >= dst_size)
+            return 0;
+          dst[out++] = src[in++];
+        }
+      bit++;
+    }
+  return out;
+}
+
+/* Decompresses the data at SRC, produced by lz_compress(), into
+   the PGSIZE bytes at DST. */
+static void
+lz_decompress (const uint8_t *src, uint8_t *dst)
+{
+  size_t out = 0;
+  uint8_t ctrl = 0;
+  int bit = 8;
+
+  while (out < PGSIZE)
+    {
+      if (bit == 8)
+        {
+          ctrl = *src++;
+          bit = 0;
+        }
+      if (ctrl & (1 << bit))
+        {
+          uint16_t word = src[0] | (src[1] << 8);
+          size_t offset = word >> 4;
+          size_t len = word & 15;
+
+          src += 2;
+          if (len == 15)
+            len += *src++;
+          len += LZ_MIN_MATCH;
+          ASSERT (offset > 0 && offset <= out && out + len <= PGSIZE);
+
+          /* Copy byte by byte, because the match may overlap the
+             bytes it produces. */
+          for (; len > 0; len--, out++)
+            dst[out] = dst[out - offset];
+        }
+      else
+        dst[out++] = *src++;
+      bit++;
+    }
+}
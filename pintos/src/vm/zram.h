@@ -0,0 +1,21 @@
+#ifndef VM_ZRAM_H
+#define VM_ZRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* A compressed page that does not exist. */
+#define ZRAM_NONE ((size_t) -1)
+
+/* Size of the compressed page pool, in pages of the kernel pool.
+   0 disables compression. */
+extern size_t zram_pages;
+
+void zram_init (void);
+bool zram_full (void);
+size_t zram_store (const void *kpage);
+void zram_load (size_t handle, void *kpage);
+void zram_free (size_t handle);
+void zram_print_stats (void);
+
+#endif /* vm/zram.h */